@@ -0,0 +1,111 @@
+/* Whole-array assertions. */
+
+#include <stdio.h>
+
+#include "itest-abbrev.h"
+
+static int squares[1000], squares_copy[1000], squares_off[1000];
+static unsigned char bytes[4096];
+static double halves[100], halves_copy[100];
+static float ones[16];
+
+typedef struct point
+{
+    int x, y;
+} point;
+
+static const point path[]     = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+static const point path_bad[] = { { 0, 0 }, { 1, 0 }, { 1, 2 }, { 0, 1 } };
+
+static int
+point_equal(const void *exp, const void *got, void *udata)
+{
+    const point *e = (const point *)exp, *g = (const point *)got;
+    (void)udata;
+    return e->x == g->x && e->y == g->y;
+}
+
+static int
+point_print(FILE *fp, const void *t, void *udata)
+{
+    const point *p = (const point *)t;
+    (void)udata;
+    return fprintf(fp, "(%d, %d)", p->x, p->y);
+}
+
+static const itest_type_info point_type_info = { point_equal, point_print };
+
+static void
+fill(void *udata)
+{
+    int i;
+    (void)udata;
+    for (i = 0; i < 1000; i++) {
+        squares[i] = squares_copy[i] = squares_off[i] = (i - 500) * i;
+    }
+    for (i = 100; i < 1000; i += 75) {
+        squares_off[i] = -1;
+    }
+    for (i = 0; i < 100; i++) {
+        halves[i] = halves_copy[i] = i / 2.0;
+    }
+    halves_copy[42] = 21.000000000000004;
+    for (i = 0; i < 16; i++) {
+        ones[i] = 1.0f;
+    }
+    ones[3] = 0.99999994f;
+}
+
+TEST
+equal_arrays(void)
+{
+    ASSERT_INT_ARRAY_EQ(squares, squares_copy, 1000);
+    ASSERT_UINT_ALL_EQ(0, bytes, sizeof bytes);
+    ASSERT_FP_ARRAY_EQ(halves, halves, 100);
+    ASSERT_ARRAY_EQUAL_T(path, path, 4, &point_type_info, NULL);
+}
+
+TEST
+int_mismatch(void)
+{
+    ASSERT_INT_ARRAY_EQ(squares, squares_off, 1000);
+}
+
+TEST
+fp_mismatch(void)
+{
+    ASSERT_FP_ARRAY_EQ(halves, halves_copy, 100);
+}
+
+TEST
+all_mismatch(void)
+{
+    ASSERT_FP_ALL_EQ(1.0, ones, 16);
+}
+
+TEST
+custom_mismatch(void)
+{
+    ASSERT_ARRAY_EQUAL_T(path, path_bad, 4, &point_type_info, NULL);
+}
+
+SUITE(arrays)
+{
+    SET_SETUP(fill, NULL);
+    RUN_TEST(equal_arrays);
+    RUN_TEST(int_mismatch);
+    RUN_TEST(fp_mismatch);
+    RUN_TEST(all_mismatch);
+    RUN_TEST(custom_mismatch);
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(arrays);
+
+    return itest_print_report();
+}
@@ -0,0 +1,76 @@
+/* The cost of assertions that succeed.  This file is built twice: as
+   assert_cost, with the usual out-of-line assertions, and as
+   assert_cost_inline, with ITEST_INLINE_ASSERTS.  `make bench` compares
+   the two.  */
+
+#include "itest-abbrev.h"
+
+#define ASSERTS_PER_CALL 100
+
+/* volatile, so that the compiler can't prove the assertions true */
+static volatile unsigned int data[ASSERTS_PER_CALL];
+
+/* The loop below, without the assertions. */
+TEST
+loop_100(void *arg)
+{
+    unsigned int i, n = 0;
+    for (i = 0; i < ASSERTS_PER_CALL; i++) {
+        n += data[i] < ASSERTS_PER_CALL;
+    }
+    data[0] = n - ASSERTS_PER_CALL;
+}
+
+TEST
+assert_100(void *arg)
+{
+    unsigned int i;
+    for (i = 0; i < ASSERTS_PER_CALL; i++) {
+        ASSERT_LT(data[i], ASSERTS_PER_CALL);
+    }
+}
+
+/* Run with -v to see the time per call, and so per 100 assertions. */
+SUITE(cost)
+{
+    RUN_BENCH(loop_100, 100000);
+    RUN_BENCH(assert_100, 100000);
+}
+
+TEST
+all_forms(void)
+{
+    ASSERT(data[1] == 0);
+    ASSERT_FALSE(data[2] != 0);
+    ASSERT_EQ(0u, data[3]);
+    ASSERT_NEQ(1u, data[4]);
+    ASSERT_GT(1u, data[5]);
+    ASSERT_GTE(0u, data[6]);
+    ASSERT_LT(data[7], 1u);
+    ASSERT_LTE(data[8], 0u);
+}
+
+TEST
+fails(void)
+{
+    ASSERT_EQm("(expected failure)", 1u, data[9]);
+}
+
+/* Both builds must give the same results and assertion count. */
+SUITE(semantics)
+{
+    RUN_TEST(all_forms);
+    RUN_TEST(fails);
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(cost);
+    RUN_SUITE(semantics);
+
+    return itest_print_report();
+}
@@ -328,6 +328,28 @@ lte_pass_and_fail(void)
     ASSERT_LTE(z, x);
 }
 
+static unsigned int calls = 0;
+
+static unsigned int
+count_call(void)
+{
+    return ++calls;
+}
+
+TEST
+rel_fmt_evaluates_args_once(void)
+{
+    ASSERT_EQ_FMT(1u, count_call(), "%u");
+    ASSERT_NEQ_FMT(1u, count_call(), "%u");
+    ASSERT_GT_FMT(4u, count_call(), "%u");
+    ASSERT_GTE_FMT(4u, count_call(), "%u");
+    ASSERT_LT_FMT(4u, count_call(), "%u");
+    ASSERT_LTE_FMT(6u, count_call(), "%u");
+    ASSERT_EQ(6u, calls);
+    /* fails, printing 0x10 and 0x7 */
+    ASSERT_LT_FMT(0x10u, count_call(), "%#x");
+}
+
 static void
 trace_setup(void *arg)
 {
@@ -430,6 +452,7 @@ SUITE(suite)
     RUN_TEST(gte_pass_and_fail);
     RUN_TEST(lt_pass_and_fail);
     RUN_TEST(lte_pass_and_fail);
+    RUN_TEST(rel_fmt_evaluates_args_once);
 }
 
 TEST
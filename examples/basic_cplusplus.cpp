@@ -1,11 +1,30 @@
 #include "itest-abbrev.h"
 
+struct point
+{
+    int x, y;
+    bool operator==(const point &o) const { return x == o.x && y == o.y; }
+};
+
 TEST
 standalone_test(void)
 {
     FAILm("(expected failure)");
 }
 
+TEST
+compare_values(void)
+{
+    const point p = { 1, 2 }, q = { 1, 2 };
+    const char *s = "abc";
+    ASSERT_EQ(3, 1u + 2u);
+    ASSERT_EQ(p, q);
+    ASSERT_NEQ(NULL, s);
+    ASSERT_LT(s, s + 1);
+    /* fails, printing 2.5 and 2 */
+    ASSERT_EQ(2.5, 5 / 2);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -13,5 +32,6 @@ main(int argc, char **argv)
     itest_parse_options(argc, argv);
 
     RUN_TEST(standalone_test);
+    RUN_TEST(compare_values);
     return itest_print_report();
 }
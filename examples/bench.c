@@ -0,0 +1,53 @@
+/* Benchmarks. */
+
+#include <stdio.h>
+
+#include "itest-abbrev.h"
+
+/* A small, fixed amount of work per call. */
+TEST
+lcg_100(void *arg)
+{
+    const itest_concurrent_env *env = (const itest_concurrent_env *)arg;
+    volatile unsigned long x        = env->iteration;
+    unsigned int i;
+    for (i = 0; i < 100; i++) {
+        x = x * 6364136223846793005ul + 1442695040888963407ul;
+    }
+}
+
+static const itest_latency_spec every_call = { 10000, 0, 0, 0, 0, 0, 0,
+                                               NULL };
+
+static const itest_latency_spec sampled = { 10000, 10, 0, 0, 0, 0, 0, NULL };
+
+/* Nothing takes less than a nanosecond. */
+static const itest_latency_spec too_fast = { 100, 0, 1, 0, 0, 0, 0, NULL };
+
+SUITE(latency)
+{
+    itest_set_test_suffix("all");
+    RUN_LATENCY(lcg_100, &every_call);
+    itest_set_test_suffix("sampled");
+    RUN_LATENCY(lcg_100, &sampled);
+    itest_set_test_suffix("too_fast");
+    RUN_LATENCY(lcg_100, &too_fast);
+}
+
+/* Under Callgrind, this reports instruction counts instead of time. */
+SUITE(throughput)
+{
+    RUN_BENCH(lcg_100, 10000);
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(throughput);
+    RUN_SUITE(latency);
+
+    return itest_print_report();
+}
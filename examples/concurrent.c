@@ -0,0 +1,102 @@
+/* Stress tests, run on several threads at once. */
+
+#include <stdio.h>
+
+#include "itest-abbrev.h"
+
+#define N_THREADS  4
+#define ITERATIONS 1000
+
+/* Each thread owns one slot, and bumps the shared total. */
+static unsigned long slots[N_THREADS];
+static unsigned long total;
+
+static void
+reset(void *unused)
+{
+    unsigned int i;
+    (void)unused;
+    for (i = 0; i < N_THREADS; i++) {
+        slots[i] = 0;
+    }
+    total = 0;
+}
+
+TEST
+bump_counters(void *arg)
+{
+    const itest_concurrent_env *env = (const itest_concurrent_env *)arg;
+    ASSERT_EQ(env->iteration, slots[env->thread]);
+    slots[env->thread]++;
+    __atomic_fetch_add(&total, 1, __ATOMIC_RELAXED);
+}
+
+TEST
+fail_once(void *arg)
+{
+    const itest_concurrent_env *env = (const itest_concurrent_env *)arg;
+    if (env->thread == 2 && env->iteration == 17) {
+        FAILm("(expected failure)");
+    }
+}
+
+TEST
+skip_all(void *arg)
+{
+    (void)arg;
+    SKIPm("not supported here");
+}
+
+/* Independent work on each thread, which should scale well. */
+TEST
+private_work(void *arg)
+{
+    const itest_concurrent_env *env = (const itest_concurrent_env *)arg;
+    volatile unsigned long x        = env->iteration;
+    unsigned int i;
+    for (i = 0; i < 100; i++) {
+        x = x * 6364136223846793005ul + 1442695040888963407ul;
+    }
+}
+
+static const unsigned int thread_counts[] = { 1, 2, 4 };
+
+static const itest_scaling_spec scale_1_2_4 = {
+    thread_counts, sizeof thread_counts / sizeof thread_counts[0], 10000,
+    0, 0.0
+};
+
+/* No thread count can be more than 100% efficient. */
+static const itest_scaling_spec impossible = {
+    thread_counts, sizeof thread_counts / sizeof thread_counts[0], 100, 1,
+    2.0
+};
+
+/* There is no run at 3 threads to check. */
+static const itest_scaling_spec unchecked = {
+    thread_counts, sizeof thread_counts / sizeof thread_counts[0], 100, 3,
+    0.5
+};
+
+SUITE(concurrent_suite)
+{
+    SET_SETUP(reset, NULL);
+    RUN_CONCURRENT(bump_counters, N_THREADS, ITERATIONS);
+    printf("\nTotal: %lu\n", total);
+    RUN_SCALING(private_work, &scale_1_2_4);
+    RUN_CONCURRENT(fail_once, N_THREADS, ITERATIONS);
+    RUN_CONCURRENT(skip_all, N_THREADS, ITERATIONS);
+    RUN_SCALING(private_work, &impossible);
+    RUN_SCALING(private_work, &unchecked);
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(concurrent_suite);
+
+    return itest_print_report();
+}
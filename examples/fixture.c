@@ -0,0 +1,104 @@
+/* Suite fixtures: built once per suite, and with --fork, shared with
+   every test copy-on-write. */
+
+#include <stdlib.h>
+
+#include "itest-abbrev.h"
+
+#define INDEX_SIZE 100000
+
+/* An expensive fixture, and how many times it was built.  */
+static int *index_table;
+static int builds;
+
+static void
+build_index(void *udata)
+{
+    int i;
+    index_table = (int *)malloc(INDEX_SIZE * sizeof *index_table);
+    for (i = 0; index_table != NULL && i < INDEX_SIZE; i++) {
+        index_table[i] = i * 2;
+    }
+    builds++;
+}
+
+static void
+free_index(void *udata)
+{
+    free(index_table);
+    index_table = NULL;
+}
+
+TEST
+lookup_first(void)
+{
+    ASSERT(index_table != NULL);
+    ASSERT_EQ(0, index_table[0]);
+    ASSERT_EQ(1, builds);
+}
+
+TEST
+lookup_last(void)
+{
+    ASSERT(index_table != NULL);
+    ASSERT_EQ(2 * (INDEX_SIZE - 1), index_table[INDEX_SIZE - 1]);
+    ASSERT_EQ(1, builds);
+}
+
+/* In a process of its own, a test can scribble on the fixture...  */
+TEST
+scribble(void)
+{
+    ASSERT(index_table != NULL);
+    index_table[0] = -1;
+    builds++;
+    ASSERT_EQ(-1, index_table[0]);
+}
+
+/* ...and the next one still sees it as built.  */
+TEST
+still_pristine(void)
+{
+    ASSERT(index_table != NULL);
+    ASSERT_EQ(0, index_table[0]);
+    ASSERT_EQ(1, builds);
+}
+
+/* A crash only fails the test that crashed (expected failure).  */
+TEST
+crash(void)
+{
+    abort();
+}
+
+SUITE(shared)
+{
+    builds = 0;
+    itest_set_suite_fixture(build_index, free_index, NULL);
+    RUN_TEST(lookup_first);
+    RUN_TEST(lookup_last);
+}
+
+SUITE(isolated)
+{
+    builds = 0;
+    itest_set_suite_fixture(build_index, free_index, NULL);
+    RUN_TEST(scribble);
+    RUN_TEST(still_pristine);
+    RUN_TEST(crash);
+    RUN_TEST(still_pristine);
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(shared);
+
+    itest_set_flag(ITEST_FLAG_FORK);
+    RUN_SUITE(isolated);
+
+    return itest_print_report();
+}
@@ -0,0 +1,112 @@
+/* Floating-point comparisons with a tolerance. */
+
+#include <float.h>
+#include <math.h>
+
+#include "itest-abbrev.h"
+
+#define N 1000
+
+static double sines[N], sines_approx[N];
+static float thirds[N], thirds_approx[N];
+
+/* sin(x) by the first TERMS terms of its Taylor series. */
+static double
+taylor_sin(double x, int terms)
+{
+    double term = x, sum = x;
+    int k;
+    for (k = 1; k < terms; k++) {
+        term *= -x * x / ((2 * k) * (2 * k + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+static void
+fill(void *udata)
+{
+    int i;
+    (void)udata;
+    for (i = 0; i < N; i++) {
+        double x        = i * (3.0 / N);
+        sines[i]        = taylor_sin(x, 30);
+        sines_approx[i] = taylor_sin(x, 8);
+        thirds[i]       = (float)i / 3.0f;
+        thirds_approx[i] = (float)i * (1.0f / 3.0f);
+    }
+}
+
+TEST
+scalars(void)
+{
+    double third = 1.0 / 3.0;
+    ASSERT_WITHIN_ULPS(1.0, 3 * third, 1);
+    ASSERT_WITHIN_ULPS(0.0, -0.0, 0);
+    ASSERT_WITHIN_ULPS(1.0f, 1.0f + FLT_EPSILON, 1);
+    ASSERT_WITHIN_ULPS((double)NAN, (double)NAN, 0);
+    ASSERT_WITHIN_REL(1e300, 1.000001e300, 1e-6);
+    ASSERT_WITHIN_REL(1e-300, 1.000001e-300, 1e-6);
+    ASSERT_WITHIN_REL((double)INFINITY, (double)INFINITY, 0);
+    ASSERT_IN_RANGE((double)NAN, (double)NAN, 0);
+}
+
+TEST
+arrays(void)
+{
+    ASSERT_ARRAY_WITHIN_ULPS(thirds, thirds_approx, N, 1);
+    ASSERT_ARRAY_WITHIN_REL(sines, sines_approx, 100, 1e-12);
+}
+
+TEST
+ulps_too_far(void)
+{
+    ASSERT_WITHIN_ULPS(1.0, 1.0 + 4 * DBL_EPSILON, 3);
+}
+
+TEST
+nan_is_not_in_range(void)
+{
+    ASSERT_IN_RANGE(1.0, (double)NAN, 1e9);
+}
+
+TEST
+nan_is_not_near(void)
+{
+    ASSERT_WITHIN_REL(1.0, (double)NAN, 1e9);
+}
+
+TEST
+series_diverges(void)
+{
+    ASSERT_ARRAY_WITHIN_REL(sines, sines_approx, N, 1e-12);
+}
+
+TEST
+float_thirds(void)
+{
+    ASSERT_ARRAY_WITHIN_ULPS(thirds, thirds_approx, N, 0);
+}
+
+SUITE(fp)
+{
+    SET_SETUP(fill, NULL);
+    RUN_TEST(scalars);
+    RUN_TEST(arrays);
+    RUN_TEST(ulps_too_far);
+    RUN_TEST(nan_is_not_in_range);
+    RUN_TEST(nan_is_not_near);
+    RUN_TEST(series_diverges);
+    RUN_TEST(float_thirds);
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(fp);
+
+    return itest_print_report();
+}
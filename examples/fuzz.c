@@ -0,0 +1,57 @@
+/* Fuzz targets: built with -DITEST_FUZZING, a libFuzzer target; built
+   normally, a test that replays the corpus in fuzz-corpus/. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "itest-abbrev.h"
+
+/* Parse a record of a length byte followed by that many bytes, setting
+   *LEN to the length.  Returns 0 if the input is too short to hold the
+   record, but gets the check wrong by one byte.  */
+static int
+parse_record(const unsigned char *data, size_t size, size_t *len)
+{
+    if (size == 0) {
+        return 0;
+    }
+    *len = data[0];
+    return *len <= size;
+}
+
+TEST
+parse_input(void *env)
+{
+    const itest_fuzz_input *in = (const itest_fuzz_input *)env;
+    size_t len;
+    if (in->size == 0) {
+        SKIPm("empty input");
+    }
+    if (parse_record(in->data, in->size, &len)) {
+        ASSERT_LTEm("(expected failure)", 1 + len, in->size);
+    }
+}
+
+FUZZ_TARGET(parse_input);
+
+#ifndef ITEST_FUZZING
+int
+main(int argc, char **argv)
+{
+    /* The corpus is next to the program.  */
+    const char *slash = strrchr(argv[0], '/');
+    int dir_len       = slash ? (int)(slash - argv[0]) : 1;
+    char corpus[4096];
+    snprintf(corpus, sizeof corpus, "%.*s/fuzz-corpus", dir_len,
+             slash ? argv[0] : ".");
+
+    itest_init();
+    itest_parse_options(argc, argv);
+
+    RUN_CORPUS(parse_input, corpus);
+    RUN_CORPUS_PARALLEL(parse_input, corpus);
+
+    return itest_print_report();
+}
+#endif
@@ -0,0 +1,89 @@
+/* Golden-file assertions: output checked against files kept with the
+   tests, which --update-golden rewrites. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "itest-abbrev.h"
+
+static char report_path[4096], copy_path[4096], new_path[4096];
+
+/* The output under test.  */
+static size_t
+render_report(char *buf, size_t size, int total)
+{
+    int n = snprintf(buf, size,
+                     "Report\n"
+                     "======\n"
+                     "items: 3\n"
+                     "total: %d\n",
+                     total);
+    return n < 0 ? 0 : (size_t)n;
+}
+
+TEST
+report_matches(void)
+{
+    char buf[256];
+    size_t len = render_report(buf, sizeof buf, 42);
+    ASSERT_MATCHES_GOLDEN(report_path, buf, len);
+}
+
+TEST
+report_differs(void)
+{
+    char buf[256];
+    size_t len = render_report(buf, sizeof buf, 43);
+    ASSERT_MATCHES_GOLDENm("(expected failure)", report_path, buf, len);
+}
+
+TEST
+copy_matches(void)
+{
+    ASSERT_FILE_MATCHES_GOLDEN(report_path, copy_path);
+}
+
+/* What --update-golden does: a file that doesn't match is rewritten
+   (or, here, created), and then it does.  */
+TEST
+update_creates(void)
+{
+    char buf[256];
+    size_t len = render_report(buf, sizeof buf, 7);
+    remove(new_path);
+    itest_set_flag(ITEST_FLAG_UPDATE_GOLDEN);
+    ASSERT_MATCHES_GOLDEN(new_path, buf, len);
+    itest_clear_flag(ITEST_FLAG_UPDATE_GOLDEN);
+    ASSERT_MATCHES_GOLDEN(new_path, buf, len);
+    remove(new_path);
+}
+
+SUITE(golden)
+{
+    RUN_TEST(report_matches);
+    RUN_TEST(report_differs);
+    RUN_TEST(copy_matches);
+    RUN_TEST(update_creates);
+}
+
+int
+main(int argc, char **argv)
+{
+    /* The golden files are next to the program.  */
+    const char *slash = strrchr(argv[0], '/');
+    int dir_len       = slash ? (int)(slash - argv[0]) : 1;
+    const char *dir   = slash ? argv[0] : ".";
+    snprintf(report_path, sizeof report_path, "%.*s/golden-data/report.txt",
+             dir_len, dir);
+    snprintf(copy_path, sizeof copy_path, "%.*s/golden-data/copy.txt",
+             dir_len, dir);
+    snprintf(new_path, sizeof new_path, "%.*s/golden-data/new.txt.tmp",
+             dir_len, dir);
+
+    itest_init();
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(golden);
+
+    return itest_print_report();
+}
@@ -0,0 +1,67 @@
+/* Tests to measure: what -P, -R, -A, --profile and --trace report. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "itest-abbrev.h"
+
+static volatile unsigned long sink;
+
+/* Enough CPU time for the profiler to take samples.  */
+TEST
+spin(void)
+{
+    unsigned long i, x = 1;
+    for (i = 0; i < 30000000; i++) {
+        x += i ^ (x >> 3);
+    }
+    sink = x;
+    ASSERT(x != 0);
+}
+
+/* Exactly two reads, of 10 and 20 bytes, for -R.  */
+TEST
+read_zeros(void)
+{
+    char buf[20];
+    int fd = open("/dev/zero", O_RDONLY);
+    ASSERT(fd >= 0);
+    ASSERT_EQ(10, (int)read(fd, buf, 10));
+    ASSERT_EQ(20, (int)read(fd, buf, 20));
+    close(fd);
+}
+
+/* Assertions made from one call site many times, for -A.  */
+TEST
+count_up(void)
+{
+    int i;
+    for (i = 0; i < 10; i++) {
+        ASSERT_EQ(i, i);
+    }
+}
+
+TEST
+fail_once(void)
+{
+    ASSERT_EQm("(expected failure)", 1, 2);
+}
+
+SUITE(measurements)
+{
+    RUN_TEST(spin);
+    RUN_TEST(read_zeros);
+    RUN_TEST(count_up);
+    RUN_TEST(fail_once);
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_parse_options(argc, argv);
+    RUN_SUITE(measurements);
+    return itest_print_report();
+}
@@ -0,0 +1,113 @@
+/* Assertions with printf-style messages, formatted only on failure. */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "itest-abbrev.h"
+
+static unsigned int describe_calls;
+
+/* An argument to a message that is costly to compute.  */
+static const char *
+describe(unsigned int i)
+{
+    describe_calls++;
+    return (i % 2) ? "odd" : "even";
+}
+
+TEST
+loop_passes(void)
+{
+    unsigned int i;
+    describe_calls = 0;
+    for (i = 0; i < 1000; i++) {
+        ASSERTf(i * i >= i, "%u (%s) squared is too small", i, describe(i));
+        ASSERT_FALSEf(i * i < i, "%u (%s) squared is too small", i,
+                      describe(i));
+    }
+    ASSERT_EQ(0u, describe_calls);
+}
+
+TEST
+loop_fails(void)
+{
+    unsigned int i;
+    for (i = 0; i < 1000; i++) {
+        ASSERTf(i * i != 49, "%u (%s) squared is 49", i, describe(i));
+    }
+}
+
+TEST
+false_fails(void)
+{
+    ASSERT_FALSEf(strlen("abc") == 3, "strlen(\"%s\") is %d", "abc", 3);
+}
+
+TEST
+skipped(void)
+{
+    SKIPf("not supported on %s", "this platform");
+}
+
+TEST
+failed(void)
+{
+    FAILf("%d of %d steps done", 3, 4);
+}
+
+TEST
+long_message(void)
+{
+    char s[400];
+    memset(s, 'x', sizeof s - 1);
+    s[sizeof s - 1] = '\0';
+    FAILf("%s", s);
+}
+
+static void *
+helper(void *arg)
+{
+    FAILf("helper %u failed", *(const unsigned int *)arg);
+}
+
+TEST
+helper_fails(void)
+{
+    pthread_t thread;
+    unsigned int index = 7;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, helper, &index));
+    ASSERT_EQ(0, pthread_join(thread, NULL));
+    CHECK_THREADS();
+}
+
+SUITE(messages)
+{
+    RUN_TEST(loop_passes);
+    RUN_TEST(loop_fails);
+    RUN_TEST(false_fails);
+    RUN_TEST(skipped);
+    RUN_TEST(failed);
+    RUN_TEST(long_message);
+    RUN_TEST(helper_fails);
+}
+
+/* Messages formatted by tests on the thread pool. */
+SUITE(messages_parallel)
+{
+    RUN_TEST_PARALLEL(loop_fails);
+    RUN_TEST_PARALLEL(failed);
+    JOIN_PARALLEL();
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_set_jobs(2);
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(messages);
+    RUN_SUITE(messages_parallel);
+
+    return itest_print_report();
+}
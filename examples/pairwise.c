@@ -0,0 +1,117 @@
+/* Combinatorial tests: covering every pair of parameter values. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "itest-abbrev.h"
+
+static const char *const oses[]      = { "linux", "bsd", "macos" };
+static const char *const compilers[] = { "gcc", "clang" };
+static const char *const opts[]      = { "O0", "O2", "Os" };
+static const char *const switches[]  = { "off", "on" };
+
+#define N_AXES 6
+
+static const itest_axis config_axes[N_AXES] = {
+    { "os", oses, 3 },     { "cc", compilers, 2 }, { "opt", opts, 3 },
+    { "lto", switches, 2 }, { "pie", switches, 2 }, { "jobs", NULL, 4 },
+};
+
+enum { OS, CC, OPT, LTO, PIE, JOBS };
+
+/* A configuration that only breaks for one pair of values. */
+static int
+config_builds(const unsigned int *config)
+{
+    return !(config[CC] == 1 && config[OPT] == 2);
+}
+
+TEST
+builds(void *env)
+{
+    const unsigned int *config = (const unsigned int *)env;
+    ASSERTm("(expected failure)", config_builds(config));
+}
+
+/* Every combination run, of its first naxes_seen axes, to check that
+   every pair was covered. */
+static unsigned int seen[256][N_AXES];
+static unsigned int nseen, naxes_seen;
+
+TEST
+record(void *env)
+{
+    ASSERT(nseen < sizeof seen / sizeof seen[0]);
+    memcpy(seen[nseen++], env, naxes_seen * sizeof seen[0][0]);
+}
+
+/* Whether some recorded combination has value V of axis A, and value W
+   of axis B.  */
+static int
+pair_seen(unsigned int a, unsigned int v, unsigned int b, unsigned int w)
+{
+    unsigned int i;
+    for (i = 0; i < nseen; i++) {
+        if (seen[i][a] == v && seen[i][b] == w) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+TEST
+every_pair_covered(void)
+{
+    unsigned int a, b, v, w;
+    for (a = 0; a < N_AXES; a++) {
+        for (b = a + 1; b < N_AXES; b++) {
+            for (v = 0; v < config_axes[a].count; v++) {
+                for (w = 0; w < config_axes[b].count; w++) {
+                    ASSERTf(pair_seen(a, v, b, w), "%s=%u, %s=%u not covered",
+                            config_axes[a].name, v, config_axes[b].name, w);
+                }
+            }
+        }
+    }
+}
+
+SUITE(pairwise)
+{
+    RUN_PAIRWISE(builds, config_axes, N_AXES);
+}
+
+/* The same, on the thread pool: each queued combination must keep its
+   own values until it has run. */
+SUITE(pairwise_parallel)
+{
+    RUN_PAIRWISE(builds, config_axes, N_AXES);
+}
+
+SUITE(coverage)
+{
+    nseen      = 0;
+    naxes_seen = N_AXES;
+    RUN_PAIRWISE(record, config_axes, N_AXES);
+    printf("\n%u combinations\n", nseen);
+    RUN_TEST(every_pair_covered);
+
+    /* Covering every combination of all the axes runs them all.  */
+    nseen      = 0;
+    naxes_seen = 3;
+    RUN_COMBINATIONS(record, config_axes, 3, 3);
+    printf("\n%u combinations\n", nseen);
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_set_jobs(4);
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(pairwise);
+    RUN_SUITE_PARALLEL(pairwise_parallel);
+    RUN_SUITE(coverage);
+
+    return itest_print_report();
+}
@@ -0,0 +1,139 @@
+/* Parallel-safe tests, run on a thread pool. */
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "itest-abbrev.h"
+
+static unsigned long
+collatz_steps(unsigned long n)
+{
+    unsigned long steps = 0;
+    while (n != 1) {
+        n = (n % 2) ? 3 * n + 1 : n / 2;
+        steps++;
+    }
+    return steps;
+}
+
+TEST
+collatz_27(void)
+{
+    ASSERT_EQ(111, collatz_steps(27));
+}
+
+TEST
+collatz_97(void)
+{
+    ASSERT_EQ(118, collatz_steps(97));
+}
+
+TEST
+collatz_wrong(void)
+{
+    ASSERT_EQm("(expected failure)", 1, collatz_steps(3));
+}
+
+TEST
+collatz_todo(void)
+{
+    SKIPm("TODO");
+}
+
+TEST
+collatz_upto(void *env)
+{
+    unsigned long limit = *(const unsigned long *)env, n;
+    for (n = 1; n <= limit; n++) {
+        ASSERT(collatz_steps(n) < 1000);
+    }
+}
+
+static const unsigned long limits[] = { 10, 100, 1000, 10000 };
+
+/* A number, and how many steps it should take.  */
+typedef struct collatz_case
+{
+    unsigned long n;
+    unsigned long steps;
+} collatz_case;
+
+/* The test a helper thread belongs to, and the case it checks.  */
+typedef struct collatz_helper_arg
+{
+    void *test;
+    const collatz_case *c;
+} collatz_helper_arg;
+
+static void *
+collatz_helper(void *varg)
+{
+    const collatz_helper_arg *arg = (const collatz_helper_arg *)varg;
+    ADOPT_TEST(arg->test);
+    ASSERT_EQm("(expected failure)", arg->c->steps,
+               collatz_steps(arg->c->n));
+    return NULL;
+}
+
+/* Check a case on a helper thread, which may be running alongside
+   other tests' helpers on the thread pool.  */
+TEST
+collatz_threaded(void *env)
+{
+    collatz_helper_arg arg;
+    pthread_t thread;
+    arg.test = CURRENT_TEST();
+    arg.c    = (const collatz_case *)env;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, collatz_helper, &arg));
+    ASSERT_EQ(0, pthread_join(thread, NULL));
+    CHECK_THREADS();
+}
+
+static const collatz_case cases[] = { { 7, 16 }, { 9, 20 } };
+
+/* Every test in this suite may run in parallel. */
+SUITE(parallel_suite)
+{
+    size_t i;
+    RUN_TEST(collatz_27);
+    RUN_TEST(collatz_wrong);
+    RUN_TEST(collatz_97);
+    RUN_TEST(collatz_todo);
+    for (i = 0; i < sizeof limits / sizeof limits[0]; i++) {
+        char suffix[8];
+        snprintf(suffix, sizeof suffix, "%lu", limits[i]);
+        itest_set_test_suffix(suffix);
+        RUN_TEST1(collatz_upto, (void *)&limits[i]);
+    }
+    for (i = 0; i < sizeof cases / sizeof cases[0]; i++) {
+        char suffix[8];
+        snprintf(suffix, sizeof suffix, "%lu", cases[i].n);
+        itest_set_test_suffix(suffix);
+        RUN_TEST1(collatz_threaded, (void *)&cases[i]);
+    }
+}
+
+/* Only some of the tests in this suite may run in parallel. */
+SUITE(mixed_suite)
+{
+    RUN_TEST_PARALLEL(collatz_27);
+    RUN_TEST_PARALLEL(collatz_97);
+    /* The two tests above are run, and reported, before this one. */
+    RUN_TEST(collatz_wrong);
+    RUN_TEST1_PARALLEL(collatz_upto, (void *)&limits[2]);
+    JOIN_PARALLEL();
+    printf("\nAll parallel tests have finished.\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_set_jobs(4);
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE_PARALLEL(parallel_suite);
+    RUN_SUITE(mixed_suite);
+
+    return itest_print_report();
+}
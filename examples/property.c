@@ -0,0 +1,183 @@
+/* Property-based tests: random inputs, shrunk to simple counterexamples
+   when a property doesn't hold. */
+
+#include <limits.h>
+#include <stdio.h>
+
+#include "itest-abbrev.h"
+
+/* A short list of small ints, as an input type.  */
+#define LIST_MAX 16
+
+typedef struct int_list
+{
+    unsigned int len;
+    int items[LIST_MAX];
+} int_list;
+
+static void
+list_generate(void *value, itest_rand *rand)
+{
+    int_list *l = (int_list *)value;
+    unsigned int i;
+    l->len = (unsigned int)itest_rand_below(rand, LIST_MAX + 1);
+    for (i = 0; i < l->len; i++) {
+        l->items[i] = (int)itest_rand_below(rand, 21) - 10;
+    }
+}
+
+/* Move V one step towards 0.  */
+static int
+towards_zero(int v)
+{
+    return v > 0 ? v - 1 : v < 0 ? v + 1 : 0;
+}
+
+/* Tactic N < len drops item N; tactic len moves every item towards 0,
+   and the ones after that move one item each.  */
+static int
+list_shrink(const void *value, void *smaller, unsigned int tactic)
+{
+    const int_list *l = (const int_list *)value;
+    int_list *s       = (int_list *)smaller;
+    unsigned int i, changed = 0;
+    *s = *l;
+    if (tactic < l->len) {
+        for (i = tactic; i + 1 < l->len; i++) {
+            s->items[i] = s->items[i + 1];
+        }
+        s->len--;
+        return ITEST_SHRINK_OK;
+    }
+    tactic -= l->len;
+    if (tactic == 0) {
+        for (i = 0; i < l->len; i++) {
+            s->items[i] = towards_zero(l->items[i]);
+            changed |= s->items[i] != l->items[i];
+        }
+        return changed ? ITEST_SHRINK_OK : ITEST_SHRINK_DEAD_END;
+    }
+    tactic--;
+    if (tactic >= l->len) {
+        return ITEST_SHRINK_NO_MORE;
+    }
+    if (l->items[tactic] == 0) {
+        return ITEST_SHRINK_DEAD_END;
+    }
+    s->items[tactic] = towards_zero(l->items[tactic]);
+    return ITEST_SHRINK_OK;
+}
+
+static void
+list_print(FILE *out, const void *value)
+{
+    const int_list *l = (const int_list *)value;
+    unsigned int i;
+    fputc('[', out);
+    for (i = 0; i < l->len; i++) {
+        fprintf(out, "%s%d", i ? ", " : "", l->items[i]);
+    }
+    fputc(']', out);
+}
+
+static const itest_prop_type list_type = {
+    sizeof(int_list),
+    list_generate,
+    list_shrink,
+    list_print,
+};
+
+static void
+insertion_sort(int_list *l)
+{
+    unsigned int i, j;
+    for (i = 1; i < l->len; i++) {
+        int v = l->items[i];
+        for (j = i; j > 0 && l->items[j - 1] > v; j--) {
+            l->items[j] = l->items[j - 1];
+        }
+        l->items[j] = v;
+    }
+}
+
+/* Meant to sort, but loses duplicates.  */
+static void
+buggy_sort(int_list *l)
+{
+    unsigned int i, n = 0;
+    insertion_sort(l);
+    for (i = 0; i < l->len; i++) {
+        if (n == 0 || l->items[n - 1] != l->items[i]) {
+            l->items[n++] = l->items[i];
+        }
+    }
+    l->len = n;
+}
+
+TEST
+sort_orders(void *input)
+{
+    int_list l = *(const int_list *)input;
+    unsigned int i;
+    insertion_sort(&l);
+    ASSERT_EQ(((const int_list *)input)->len, l.len);
+    for (i = 1; i < l.len; i++) {
+        ASSERT_LTE(l.items[i - 1], l.items[i]);
+    }
+}
+
+TEST
+buggy_sort_keeps_length(void *input)
+{
+    int_list l = *(const int_list *)input;
+    buggy_sort(&l);
+    ASSERT_EQm("(expected failure)", ((const int_list *)input)->len, l.len);
+}
+
+static int
+my_abs(int x)
+{
+    return x < 0 ? -x : x;
+}
+
+TEST
+abs_not_negative(void *input)
+{
+    int x = *(const int *)input;
+    if (x == INT_MIN) {
+        SKIPm("-INT_MIN overflows");
+    }
+    ASSERT_GTE(my_abs(x), 0);
+}
+
+TEST
+halving_shrinks(void *input)
+{
+    unsigned int x = *(const unsigned int *)input;
+    ASSERTm("(expected failure)", x / 2 < x);
+}
+
+/* Trials of a property that passes can be spread over threads; the
+   one that fails is run on one thread, so that the number of trials run
+   (and so of assertions made) before it stops is always the same.  */
+static const itest_prop_spec many_trials = { 2000, 0, 4, 0 };
+static const itest_prop_spec one_thread  = { 2000, 0, 1, 0 };
+
+SUITE(properties)
+{
+    RUN_PROPERTY(sort_orders, &list_type, &many_trials);
+    RUN_PROPERTY(buggy_sort_keeps_length, &list_type, &one_thread);
+    RUN_PROPERTY(abs_not_negative, &itest_prop_int, NULL);
+    RUN_PROPERTY(halving_shrinks, &itest_prop_uint, NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(properties);
+
+    return itest_print_report();
+}
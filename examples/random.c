@@ -0,0 +1,83 @@
+/* Per-test random streams: the same values for a test, whatever order
+   the tests run in. */
+
+#include <stdio.h>
+
+#include "itest-abbrev.h"
+
+enum { IN_ORDER, SHUFFLED, PARALLEL, N_RUNS };
+
+/* The first value each test drew, in each run.  */
+static unsigned long long drawn[N_RUNS][3];
+static int run;
+
+static void
+draw(int test)
+{
+    itest_rand *rand = itest_test_rand();
+    drawn[run][test] = itest_rand_u64(rand);
+    ASSERT_LT(itest_rand_below(rand, 6), 6);
+}
+
+TEST
+roll_a(void)
+{
+    draw(0);
+}
+
+TEST
+roll_b(void)
+{
+    draw(1);
+}
+
+TEST
+roll_c(void)
+{
+    draw(2);
+}
+
+TEST
+same_in_every_order(void)
+{
+    int i;
+    for (i = 0; i < 3; i++) {
+        ASSERT_EQ(drawn[IN_ORDER][i], drawn[SHUFFLED][i]);
+        ASSERT_EQ(drawn[IN_ORDER][i], drawn[PARALLEL][i]);
+    }
+    ASSERT_NEQ(drawn[IN_ORDER][0], drawn[IN_ORDER][1]);
+    ASSERT_NEQ(drawn[IN_ORDER][1], drawn[IN_ORDER][2]);
+}
+
+SUITE(streams)
+{
+    run = IN_ORDER;
+    RUN_TEST(roll_a);
+    RUN_TEST(roll_b);
+    RUN_TEST(roll_c);
+
+    run = SHUFFLED;
+    SHUFFLE_TESTS (3) {
+        RUN_TEST(roll_a);
+        RUN_TEST(roll_b);
+        RUN_TEST(roll_c);
+    }
+
+    run = PARALLEL;
+    RUN_TEST_PARALLEL(roll_a);
+    RUN_TEST_PARALLEL(roll_b);
+    RUN_TEST_PARALLEL(roll_c);
+
+    RUN_TEST(same_in_every_order);
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(streams);
+
+    return itest_print_report();
+}
@@ -0,0 +1,94 @@
+/* Table-driven tests: one test per element of an array of cases. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "itest-abbrev.h"
+
+typedef struct parse_case
+{
+    const char *name;
+    const char *input;
+    long expected;
+} parse_case;
+
+static const parse_case parse_cases[] = {
+    { "zero", "0", 0 },
+    { "positive", "42", 42 },
+    { "negative", "-17", -17 },
+    { "hex", "0x1f", 31 },
+    { "wrong", "10", 11 }, /* expected failure */
+    { "octal", "010", 8 },
+};
+
+static unsigned int name_lookups;
+
+static const char *
+parse_case_name(const void *test_case)
+{
+    name_lookups++;
+    return ((const parse_case *)test_case)->name;
+}
+
+TEST
+parses(void *env)
+{
+    const parse_case *c = (const parse_case *)env;
+    ASSERT_EQ(c->expected, strtol(c->input, NULL, 0));
+}
+
+#define N_SQUARES 200
+
+static unsigned int squares[N_SQUARES];
+
+TEST
+square_root(void *env)
+{
+    const unsigned int *sq = (const unsigned int *)env;
+    unsigned int i         = (unsigned int)(sq - squares);
+    ASSERT_EQ(i * i, *sq);
+}
+
+SUITE(named_cases)
+{
+    RUN_TABLE(parses, parse_cases, sizeof parse_cases / sizeof *parse_cases,
+              parse_case_name);
+}
+
+/* Cases named by their index; also shows that a case's name is only
+   looked up when it is printed: never for a pass without -v, and not
+   for the cases passed over while shuffling a long table. */
+SUITE(numbered_cases)
+{
+    unsigned int i;
+    for (i = 0; i < N_SQUARES; i++) {
+        squares[i] = i * i;
+    }
+    name_lookups = 0;
+    SHUFFLE_TESTS(12345)
+    {
+        RUN_TABLE(parses, parse_cases + 5, 1, parse_case_name);
+        RUN_TABLE(square_root, squares, N_SQUARES, NULL);
+    }
+    printf("\nname lookups: %u\n", name_lookups);
+}
+
+/* The cases before the wrong one, on the thread pool. */
+SUITE(parallel_cases)
+{
+    RUN_TABLE_PARALLEL(parses, parse_cases, 4, parse_case_name);
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_set_jobs(2);
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(named_cases);
+    RUN_SUITE(numbered_cases);
+    RUN_SUITE(parallel_cases);
+
+    return itest_print_report();
+}
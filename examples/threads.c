@@ -0,0 +1,108 @@
+/* Assertions made from helper threads started by a test. */
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "itest-abbrev.h"
+
+#define N_HELPERS 4
+
+/* Each helper thread checks that its slot of a shared array was filled
+   in correctly.  If BAD is not negative, the helper with that index
+   finds a wrong value.  */
+typedef struct helper_env
+{
+    unsigned int index;
+    int bad;
+    int skip;
+    int values[N_HELPERS];
+} helper_env;
+
+static void *
+helper(void *arg)
+{
+    helper_env *env = (helper_env *)arg;
+    unsigned int i;
+    for (i = 0; i < 100; i++) {
+        ASSERT_EQ(env->values[env->index], (int)env->index * 2);
+    }
+    if (env->skip && env->index == 0) {
+        SKIPm("helper thread asked to skip");
+    }
+    ASSERT_FALSEm("helper thread found a bad value",
+                  (int)env->index == env->bad);
+    return NULL;
+}
+
+/* Start one helper thread per slot, then join them all. */
+static void
+run_helpers(int bad, int skip, int check)
+{
+    pthread_t threads[N_HELPERS];
+    helper_env envs[N_HELPERS];
+    unsigned int i;
+    for (i = 0; i < N_HELPERS; i++) {
+        unsigned int j;
+        envs[i].index = i;
+        envs[i].bad   = bad;
+        envs[i].skip  = skip;
+        for (j = 0; j < N_HELPERS; j++) {
+            envs[i].values[j] = (int)j * 2;
+        }
+        ASSERT_EQ(0, pthread_create(&threads[i], NULL, helper, &envs[i]));
+    }
+    for (i = 0; i < N_HELPERS; i++) {
+        ASSERT_EQ(0, pthread_join(threads[i], NULL));
+    }
+    if (check) {
+        CHECK_THREADS();
+        printf("\nAll helper threads passed.\n");
+    }
+}
+
+TEST
+helpers_pass(void)
+{
+    run_helpers(-1, 0, 1);
+}
+
+TEST
+helper_fails(void)
+{
+    run_helpers(2, 0, 1);
+}
+
+TEST
+helper_fails_without_check(void)
+{
+    /* The failure is noticed when the test function returns. */
+    run_helpers(1, 0, 0);
+}
+
+TEST
+helper_skips(void)
+{
+    run_helpers(-1, 1, 1);
+}
+
+SUITE(helper_threads)
+{
+    RUN_TEST(helpers_pass);
+    printf("\nThis should fail:\n");
+    RUN_TEST(helper_fails);
+    printf("\nThis should fail:\n");
+    RUN_TEST(helper_fails_without_check);
+    printf("\nThis should be skipped:\n");
+    RUN_TEST(helper_skips);
+}
+
+int
+main(int argc, char **argv)
+{
+    itest_init();
+    itest_parse_options(argc, argv);
+
+    RUN_SUITE(helper_threads);
+
+    return itest_print_report();
+}
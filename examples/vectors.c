@@ -0,0 +1,57 @@
+/* Data-driven tests: one test per record of a test-vector file. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "itest-abbrev.h"
+
+/* Lines of sums.txt are "A+B=C", or empty.  */
+TEST
+adds_up(void *env)
+{
+    const itest_record *r = (const itest_record *)env;
+    char line[64];
+    int a, b, c;
+    if (r->size == 0) {
+        SKIPm("empty line");
+    }
+    ASSERT(r->size < sizeof line);
+    memcpy(line, r->data, r->size); /* records aren't NUL-terminated */
+    line[r->size] = '\0';
+    ASSERT_EQ(3, sscanf(line, "%d+%d=%d", &a, &b, &c));
+    ASSERT_EQm(c == 3 ? "(expected failure)" : NULL, c, a + b);
+}
+
+/* Records of words.bin are lowercase words, or empty; the last one is
+   truncated, which fails.  */
+TEST
+lowercase(void *env)
+{
+    const itest_record *r = (const itest_record *)env;
+    size_t i;
+    for (i = 0; i < r->size; i++) {
+        ASSERT(r->data[i] >= 'a' && r->data[i] <= 'z');
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    /* The files are next to the program.  */
+    const char *slash = strrchr(argv[0], '/');
+    int dir_len       = slash ? (int)(slash - argv[0]) : 1;
+    const char *dir   = slash ? argv[0] : ".";
+    char sums[4096], words[4096];
+    snprintf(sums, sizeof sums, "%.*s/vectors-data/sums.txt", dir_len, dir);
+    snprintf(words, sizeof words, "%.*s/vectors-data/words.bin", dir_len,
+             dir);
+
+    itest_init();
+    itest_parse_options(argc, argv);
+
+    RUN_VECTORS(adds_up, sums, ITEST_VECTORS_LINES);
+    RUN_VECTORS_PARALLEL(adds_up, sums, ITEST_VECTORS_LINES);
+    RUN_VECTORS(lowercase, words, ITEST_VECTORS_LEN32BE);
+
+    return itest_print_report();
+}
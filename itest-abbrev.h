@@ -40,6 +40,11 @@
 #define ASSERT_LT        ITEST_ASSERT_LT
 #define ASSERT_LTE       ITEST_ASSERT_LTE
 #define ASSERT_EQ_FMT    ITEST_ASSERT_EQ_FMT
+#define ASSERT_NEQ_FMT   ITEST_ASSERT_NEQ_FMT
+#define ASSERT_GT_FMT    ITEST_ASSERT_GT_FMT
+#define ASSERT_GTE_FMT   ITEST_ASSERT_GTE_FMT
+#define ASSERT_LT_FMT    ITEST_ASSERT_LT_FMT
+#define ASSERT_LTE_FMT   ITEST_ASSERT_LTE_FMT
 #define ASSERT_IN_RANGE  ITEST_ASSERT_IN_RANGE
 #define ASSERT_EQUAL_T   ITEST_ASSERT_EQUAL_T
 #define ASSERT_STR_EQ    ITEST_ASSERT_STR_EQ
@@ -47,6 +52,8 @@
 #define ASSERT_MEM_EQ    ITEST_ASSERT_MEM_EQ
 #define ASSERT_ENUM_EQ   ITEST_ASSERT_ENUM_EQ
 #define ASSERT_FALSEm    ITEST_ASSERT_FALSEm
+#define ASSERTf          ITEST_ASSERTf
+#define ASSERT_FALSEf    ITEST_ASSERT_FALSEf
 #define ASSERT_EQm       ITEST_ASSERT_EQm
 #define ASSERT_NEQm      ITEST_ASSERT_NEQm
 #define ASSERT_GTm       ITEST_ASSERT_GTm
@@ -54,6 +61,11 @@
 #define ASSERT_LTm       ITEST_ASSERT_LTm
 #define ASSERT_LTEm      ITEST_ASSERT_LTEm
 #define ASSERT_EQ_FMTm   ITEST_ASSERT_EQ_FMTm
+#define ASSERT_NEQ_FMTm  ITEST_ASSERT_NEQ_FMTm
+#define ASSERT_GT_FMTm   ITEST_ASSERT_GT_FMTm
+#define ASSERT_GTE_FMTm  ITEST_ASSERT_GTE_FMTm
+#define ASSERT_LT_FMTm   ITEST_ASSERT_LT_FMTm
+#define ASSERT_LTE_FMTm  ITEST_ASSERT_LTE_FMTm
 #define ASSERT_IN_RANGEm ITEST_ASSERT_IN_RANGEm
 #define ASSERT_EQUAL_Tm  ITEST_ASSERT_EQUAL_Tm
 #define ASSERT_STR_EQm   ITEST_ASSERT_STR_EQm
@@ -64,9 +76,62 @@
 #define SKIP             ITEST_SKIP
 #define FAILm            ITEST_FAILm
 #define SKIPm            ITEST_SKIPm
+#define FAILf            ITEST_FAILf
+#define SKIPf            ITEST_SKIPf
+#define CHECK_THREADS    ITEST_CHECK_THREADS
+#define CURRENT_TEST     ITEST_CURRENT_TEST
+#define ADOPT_TEST       ITEST_ADOPT_TEST
 #define SET_SETUP        itest_set_setup_cb
 #define SET_TEARDOWN     itest_set_teardown_cb
 #define SHUFFLE_TESTS    ITEST_SHUFFLE_TESTS
 #define SHUFFLE_SUITES   ITEST_SHUFFLE_SUITES
 
+#define RUN_TEST_PARALLEL    ITEST_RUN_TEST_PARALLEL
+#define RUN_TEST1_PARALLEL   ITEST_RUN_TEST1_PARALLEL
+#define RUN_SUITE_PARALLEL   ITEST_RUN_SUITE_PARALLEL
+#define JOIN_PARALLEL        ITEST_JOIN_PARALLEL
+#define RUN_CONCURRENT       ITEST_RUN_CONCURRENT
+#define RUN_SCALING          ITEST_RUN_SCALING
+#define RUN_LATENCY          ITEST_RUN_LATENCY
+#define RUN_BENCH            ITEST_RUN_BENCH
+#define RUN_TABLE            ITEST_RUN_TABLE
+#define RUN_TABLE_PARALLEL   ITEST_RUN_TABLE_PARALLEL
+#define RUN_PAIRWISE         ITEST_RUN_PAIRWISE
+#define RUN_COMBINATIONS     ITEST_RUN_COMBINATIONS
+#define RUN_PROPERTY         ITEST_RUN_PROPERTY
+#define RUN_CORPUS           ITEST_RUN_CORPUS
+#define RUN_CORPUS_PARALLEL  ITEST_RUN_CORPUS_PARALLEL
+#define FUZZ_TARGET          ITEST_FUZZ_TARGET
+#define RUN_VECTORS          ITEST_RUN_VECTORS
+#define RUN_VECTORS_PARALLEL ITEST_RUN_VECTORS_PARALLEL
+
+#define ASSERT_INT_ARRAY_EQ   ITEST_ASSERT_INT_ARRAY_EQ
+#define ASSERT_UINT_ARRAY_EQ  ITEST_ASSERT_UINT_ARRAY_EQ
+#define ASSERT_FP_ARRAY_EQ    ITEST_ASSERT_FP_ARRAY_EQ
+#define ASSERT_ARRAY_EQUAL_T  ITEST_ASSERT_ARRAY_EQUAL_T
+#define ASSERT_INT_ALL_EQ     ITEST_ASSERT_INT_ALL_EQ
+#define ASSERT_UINT_ALL_EQ    ITEST_ASSERT_UINT_ALL_EQ
+#define ASSERT_FP_ALL_EQ      ITEST_ASSERT_FP_ALL_EQ
+#define ASSERT_INT_ARRAY_EQm  ITEST_ASSERT_INT_ARRAY_EQm
+#define ASSERT_UINT_ARRAY_EQm ITEST_ASSERT_UINT_ARRAY_EQm
+#define ASSERT_FP_ARRAY_EQm   ITEST_ASSERT_FP_ARRAY_EQm
+#define ASSERT_ARRAY_EQUAL_Tm ITEST_ASSERT_ARRAY_EQUAL_Tm
+#define ASSERT_INT_ALL_EQm    ITEST_ASSERT_INT_ALL_EQm
+#define ASSERT_UINT_ALL_EQm   ITEST_ASSERT_UINT_ALL_EQm
+#define ASSERT_FP_ALL_EQm     ITEST_ASSERT_FP_ALL_EQm
+
+#define ASSERT_WITHIN_ULPS        ITEST_ASSERT_WITHIN_ULPS
+#define ASSERT_WITHIN_REL         ITEST_ASSERT_WITHIN_REL
+#define ASSERT_ARRAY_WITHIN_ULPS  ITEST_ASSERT_ARRAY_WITHIN_ULPS
+#define ASSERT_ARRAY_WITHIN_REL   ITEST_ASSERT_ARRAY_WITHIN_REL
+#define ASSERT_WITHIN_ULPSm       ITEST_ASSERT_WITHIN_ULPSm
+#define ASSERT_WITHIN_RELm        ITEST_ASSERT_WITHIN_RELm
+#define ASSERT_ARRAY_WITHIN_ULPSm ITEST_ASSERT_ARRAY_WITHIN_ULPSm
+#define ASSERT_ARRAY_WITHIN_RELm  ITEST_ASSERT_ARRAY_WITHIN_RELm
+
+#define ASSERT_MATCHES_GOLDEN       ITEST_ASSERT_MATCHES_GOLDEN
+#define ASSERT_FILE_MATCHES_GOLDEN  ITEST_ASSERT_FILE_MATCHES_GOLDEN
+#define ASSERT_MATCHES_GOLDENm      ITEST_ASSERT_MATCHES_GOLDENm
+#define ASSERT_FILE_MATCHES_GOLDENm ITEST_ASSERT_FILE_MATCHES_GOLDENm
+
 #endif /* itest-abbrev.h */
@@ -15,6 +15,16 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+/* Request POSIX interfaces from the C library, if it has them.  This
+   must come before any system header is included.  */
+#if !defined _POSIX_C_SOURCE && !defined _XOPEN_SOURCE
+#    define _XOPEN_SOURCE 700
+#endif
+/* Also request syscall(), for perf_event_open, from glibc.  */
+#if defined __linux__ && !defined _DEFAULT_SOURCE
+#    define _DEFAULT_SOURCE 1
+#endif
+
 #include "itest.h"
 
 /***********
@@ -31,11 +41,149 @@
 #    define ITEST_TESTNAME_BUF_SIZE 128
 #endif
 
+/* Size of buffer for a message formatted by ITEST_FAILf and friends,
+   including the terminating NUL; longer messages are truncated. */
+#ifndef ITEST_MESSAGE_BUF_SIZE
+#    define ITEST_MESSAGE_BUF_SIZE 256
+#endif
+
+/* Number of differing elements listed when an array assertion fails. */
+#ifndef ITEST_ARRAY_MISMATCHES
+#    define ITEST_ARRAY_MISMATCHES 8
+#endif
+
+/* Default number of inputs tried by ITEST_RUN_PROPERTY, and the most
+   simpler inputs it tries while shrinking a counterexample. */
+#ifndef ITEST_PROP_TRIALS
+#    define ITEST_PROP_TRIALS 100
+#endif
+#ifndef ITEST_PROP_SHRINKS
+#    define ITEST_PROP_SHRINKS 1000
+#endif
+
+/* Number of property trials a thread claims at once. */
+#ifndef ITEST_PROP_BATCH
+#    define ITEST_PROP_BATCH 16
+#endif
+
+/* Number of table cases, covering-array rows, corpus files or
+   test-vector records queued on the thread pool at once. */
+#ifndef ITEST_VECTORS_BATCH
+#    define ITEST_VECTORS_BATCH 4096
+#endif
+
+/* Use POSIX threads?  Needed for an assertion that fails in a helper
+   thread to terminate that thread.  */
+#ifndef ITEST_USE_PTHREADS
+#    if defined __unix__ || (defined __APPLE__ && defined __MACH__)
+#        define ITEST_USE_PTHREADS 1
+#    else
+#        define ITEST_USE_PTHREADS 0
+#    endif
+#endif
+
+/* Use Valgrind client requests?  Needed for benchmarks run under
+   Callgrind to count only the measured code.  */
+#ifndef ITEST_USE_VALGRIND
+#    if defined __has_include
+#        if __has_include(<valgrind/callgrind.h>)
+#            define ITEST_USE_VALGRIND 1
+#        endif
+#    endif
+#    ifndef ITEST_USE_VALGRIND
+#        define ITEST_USE_VALGRIND 0
+#    endif
+#endif
+
+/* Use Linux perf_event counters?  Needed for the -P switch.  */
+#ifndef ITEST_USE_PERF_EVENT
+#    if defined __linux__ && defined __has_include
+#        if __has_include(<linux/perf_event.h>)
+#            define ITEST_USE_PERF_EVENT 1
+#        endif
+#    endif
+#    ifndef ITEST_USE_PERF_EVENT
+#        define ITEST_USE_PERF_EVENT 0
+#    endif
+#endif
+
+/* Use getrusage?  Needed for the -R switch.  */
+#ifndef ITEST_USE_RUSAGE
+#    if defined __unix__ || (defined __APPLE__ && defined __MACH__)
+#        define ITEST_USE_RUSAGE 1
+#    else
+#        define ITEST_USE_RUSAGE 0
+#    endif
+#endif
+
+/* Use mmap and opendir?  Needed to replay a corpus directory with
+   ITEST_RUN_CORPUS; without them, files are read with stdio.  */
+#ifndef ITEST_USE_MMAP
+#    if defined __unix__ || (defined __APPLE__ && defined __MACH__)
+#        define ITEST_USE_MMAP 1
+#    else
+#        define ITEST_USE_MMAP 0
+#    endif
+#endif
+
+/* Use fork and waitpid?  Needed to run tests in child processes with
+   --fork; without them, --fork is ignored.  */
+#ifndef ITEST_USE_FORK
+#    if defined __unix__ || (defined __APPLE__ && defined __MACH__)
+#        define ITEST_USE_FORK 1
+#    else
+#        define ITEST_USE_FORK 0
+#    endif
+#endif
+
+/* Number of tests listed for each metric by the -R switch's summary. */
+#ifndef ITEST_USAGE_TOP_N
+#    define ITEST_USAGE_TOP_N 5
+#endif
+
+/* Number of assertion call sites counted by the -A switch (a power of
+   two), and number listed for each test and for the whole run.  */
+#ifndef ITEST_ASSERT_SITES
+#    define ITEST_ASSERT_SITES 1024
+#endif
+#ifndef ITEST_ASSERT_SITES_TOP_N
+#    define ITEST_ASSERT_SITES_TOP_N 5
+#endif
+
+/* Use a SIGPROF sampling profiler with backtrace()?  Needed for the
+   --profile switch.  */
+#ifndef ITEST_USE_PROFILER
+#    if defined __unix__ && defined __has_include
+#        if __has_include(<execinfo.h>)
+#            define ITEST_USE_PROFILER 1
+#        endif
+#    endif
+#    ifndef ITEST_USE_PROFILER
+#        define ITEST_USE_PROFILER 0
+#    endif
+#endif
+
+/* Default sampling rate for --profile, in samples per CPU second. */
+#ifndef ITEST_PROFILE_HZ
+#    define ITEST_PROFILE_HZ 997
+#endif
+
+/* Most samples recorded per test by --profile, and deepest stack
+   recorded for each. */
+#ifndef ITEST_PROFILE_SAMPLES
+#    define ITEST_PROFILE_SAMPLES 8192
+#endif
+#ifndef ITEST_PROFILE_DEPTH
+#    define ITEST_PROFILE_DEPTH 64
+#endif
+
 /* System headers */
 
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <limits.h>
+#include <math.h>
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -43,12 +191,143 @@
 #include <string.h>
 #include <time.h>
 
+#if ITEST_USE_PTHREADS
+#    include <pthread.h>
+#    include <unistd.h>
+#endif
+
+#if ITEST_USE_VALGRIND
+#    include <unistd.h>
+#    include <valgrind/callgrind.h>
+#endif
+
+#if ITEST_USE_RUSAGE
+#    include <sys/resource.h>
+#endif
+
+#if ITEST_USE_MMAP
+#    include <dirent.h>
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#if ITEST_USE_FORK
+#    include <sys/wait.h>
+#    include <unistd.h>
+#endif
+
+#if defined __linux__
+#    include <fcntl.h> /* for /proc/self/io */
+#    include <unistd.h>
+#endif
+
+#if ITEST_USE_PROFILER
+#    include <execinfo.h>
+#    include <signal.h>
+#    include <sys/time.h>
+#endif
+
+#if ITEST_USE_PERF_EVENT
+#    include <linux/perf_event.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
 /* Infinitestimal: out-of-line test harness code.  */
 
+/* Atomic operations on plain integer variables (if we can).  Without
+   these, assertions made from helper threads are not thread-safe.  */
+#if defined __GNUC__ && defined __ATOMIC_ACQUIRE
+#    define ITEST_ATOMIC_INC(p)                                              \
+        ((void)__atomic_add_fetch(p, 1, __ATOMIC_RELAXED))
+#    define ITEST_ATOMIC_FETCH_ADD(p, v)                                     \
+        __atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+#    define ITEST_ATOMIC_XCHG(p, v)                                          \
+        __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL)
+#    define ITEST_ATOMIC_LOAD(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#    define ITEST_ATOMIC_STORE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#    define ITEST_ATOMIC_CAS(p, e, d)                                        \
+        __atomic_compare_exchange_n(p, e, d, 0, __ATOMIC_SEQ_CST,            \
+                                    __ATOMIC_RELAXED)
+#    define ITEST_ATOMIC_FENCE()     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#    define ITEST_HAVE_ATOMICS       1
+#else
+#    define ITEST_ATOMIC_INC(p)          ((void)++*(p))
+#    define ITEST_ATOMIC_FETCH_ADD(p, v) ((*(p) += (v)) - (v))
+#    define ITEST_ATOMIC_XCHG(p, v)      itest_nonatomic_xchg(p, v)
+#    define ITEST_ATOMIC_LOAD(p)         (*(p))
+#    define ITEST_ATOMIC_STORE(p, v)     ((void)(*(p) = (v)))
+#    define ITEST_ATOMIC_CAS(p, e, d)                                        \
+        (*(p) == *(e) ? (*(p) = (d), 1) : (*(e) = *(p), 0))
+static unsigned int
+itest_nonatomic_xchg(unsigned int *p, unsigned int v)
+{
+    unsigned int old = *p;
+    *p               = v;
+    return old;
+}
+#endif
+
+/* Running tests in parallel needs both threads and atomics.  */
+#if ITEST_USE_PTHREADS && defined ITEST_HAVE_ATOMICS
+#    define ITEST_PARALLEL 1
+#else
+#    define ITEST_PARALLEL 0
+#endif
+
 /*********
  * Types *
  *********/
 
+/* Number of events counted by the -P switch.  */
+#define ITEST_PERF_EVENTS 7
+
+/* Number of resource usage metrics recorded by the -R switch.  */
+#define ITEST_USAGE_METRICS 9
+
+/* Kinds of span in a --trace timeline.  */
+enum itest_trace_kind
+{
+    ITEST_TRACE_RUN,
+    ITEST_TRACE_SUITE,
+    ITEST_TRACE_TEST,
+    ITEST_TRACE_SETUP,
+    ITEST_TRACE_TEARDOWN
+};
+
+/* A span in a --trace timeline, waiting to be written out.  Times are
+   in nanoseconds since the run began.  */
+typedef struct itest_trace_event
+{
+    unsigned long long begin;
+    unsigned long long end;
+    size_t name; /* offset in itest_info.trace_names */
+    unsigned int tid;
+    unsigned char kind;
+    unsigned char result; /* for tests */
+} itest_trace_event;
+
+/* A test with one of the highest values of a resource usage metric. */
+typedef struct itest_usage_top
+{
+    unsigned long long value;
+    char name[ITEST_TESTNAME_BUF_SIZE];
+} itest_usage_top;
+
+/* An assertion call site, and how many times it has been reached, for
+   -A.  The thread that claims an empty slot stores file, then line,
+   then ready; the others wait for ready before looking at line.  */
+typedef struct itest_assert_site
+{
+    const char *file;
+    unsigned int line;
+    unsigned int ready;
+    unsigned long count;      /* over the whole run */
+    unsigned long test_count; /* during the current test */
+} itest_assert_site;
+
 typedef struct itest_memory_cmp_env
 {
     const unsigned char *exp;
@@ -83,22 +362,145 @@ typedef enum itest_test_res
 /* Info for the current running suite. */
 typedef struct itest_suite_info
 {
+    const char *name;
     unsigned int tests_run;
     unsigned int passed;
     unsigned int failed;
     unsigned int skipped;
 
-    /* timers, pre/post running suite and individual tests */
+    /* run tests in this suite on the thread pool? */
+    unsigned char parallel;
+
+    /* timers, pre/post running suite */
     clock_t pre_suite;
     clock_t post_suite;
+
+    /* wall clock time when the suite began, for --trace */
+    unsigned long long wall_begin;
+
+    /* time spent in setup hooks, test bodies, and teardown hooks, for
+       the tests that had a hook */
+    unsigned int fixture_tests;
+    unsigned long setup_ticks;
+    unsigned long body_ticks;
+    unsigned long teardown_ticks;
+
+    /* suite setup and teardown hooks, and their userdata; the setup
+       hook runs before the suite's first test (suite_state goes from
+       0 to 1), so not at all if every test is filtered out, and the
+       teardown hook at the end of the suite if it did */
+    itest_setup_cb *suite_setup;
+    itest_teardown_cb *suite_teardown;
+    void *suite_udata;
+    unsigned char suite_state;
+    unsigned long suite_setup_ticks;
+    unsigned long suite_teardown_ticks;
+} itest_suite_info;
+
+/* State of one running test.  Owned by the thread that runs the test;
+   helper threads started by the test only touch the thread_* fields. */
+typedef struct itest_test_ctx
+{
+    /* info to print about the failure */
+    unsigned int fail_line;
+    const char *fail_file;
+    const char *msg;
+    char msg_buf[ITEST_MESSAGE_BUF_SIZE]; /* msg, if formatted */
+
+    /* the test's full name (NULL for the main thread's test), and its
+       random stream, seeded from the name by the first call to
+       itest_test_rand, which sets rand_ready */
+    const char *name;
+    itest_rand rand;
+    unsigned char rand_ready;
+
+    /* Failure or skip reported by a helper thread of the test.
+       Only the first one is recorded: the thread that flips
+       thread_claimed fills in the other fields, then publishes them by
+       storing a nonzero thread_res.  */
+    unsigned int thread_claimed;
+    unsigned int thread_res;
+    unsigned int thread_fail_line;
+    const char *thread_fail_file;
+    const char *thread_msg;
+    char thread_msg_buf[ITEST_MESSAGE_BUF_SIZE];
+
+    /* timers: before setup, before and after the test body, and after
+       teardown; has_fixture is set if there was a setup or teardown
+       hook */
     clock_t pre_test;
+    clock_t pre_body;
+    clock_t post_body;
     clock_t post_test;
-} itest_suite_info;
+    unsigned char has_fixture;
+
+    /* wall clock times matching the timers above, for --trace; and the
+       thread pool worker that ran the test (0 for the main thread) */
+    unsigned long long wall_pre_test;
+    unsigned long long wall_pre_body;
+    unsigned long long wall_post_body;
+    unsigned long long wall_post_test;
+    unsigned int worker;
+
+    /* event counters, pre/post running the test; only meaningful if
+       perf_valid is set */
+    unsigned long long perf_pre[ITEST_PERF_EVENTS];
+    unsigned long long perf_post[ITEST_PERF_EVENTS];
+    unsigned char perf_valid;
+
+    /* resource usage, pre/post running the test; only meaningful if
+       usage_valid is set */
+    unsigned long long usage_pre[ITEST_USAGE_METRICS];
+    unsigned long long usage_post[ITEST_USAGE_METRICS];
+    unsigned char usage_valid;
+
+    /* the assertion call sites this test reached most often; only
+       meaningful if sites_valid is set */
+    itest_assert_site sites_top[ITEST_ASSERT_SITES_TOP_N];
+    unsigned char sites_valid;
+
+    /* for a test run on the thread pool, the details of its failed
+       assertions, printed with its result; detail is created when
+       first needed if buffer_detail is set */
+    FILE *detail;
+    unsigned char buffer_detail;
+
+    jmp_buf jump_dest;
+} itest_test_ctx;
+
+/* A test queued to run on the thread pool. */
+typedef struct itest_job
+{
+    /* exactly one of test_cb and test_env_cb is set */
+    itest_test_cb *test_cb;
+    itest_test_env_cb *test_env_cb;
+    void *env;
+
+    /* setup/teardown hooks in effect when the test was queued */
+    itest_setup_cb *setup;
+    void *setup_udata;
+    itest_teardown_cb *teardown;
+    void *teardown_udata;
+
+    int res; /* an itest_test_res, or -1 if the test was not run */
+    itest_test_ctx ctx;
+    char name[ITEST_TESTNAME_BUF_SIZE];
+} itest_job;
+
+/* Work-stealing deque of job indices (Chase and Lev, 2005).  The
+   owning worker pops from the bottom; other workers steal from the top.
+   All jobs are pushed before any worker starts, so it never grows.  */
+typedef struct itest_deque
+{
+    long top;
+    long bottom;
+    size_t *items;
+} itest_deque;
 
 /* Struct containing all test runner state. */
 typedef struct itest_run_info
 {
-    unsigned char flags;
+    unsigned int flags;
     unsigned char verbosity;
     unsigned char running_test; /* guard for nested RUN_TEST calls */
     unsigned char exact_name_match;
@@ -114,10 +516,77 @@ typedef struct itest_run_info
     unsigned int skipped;
     unsigned int assertions;
 
-    /* info to print about the most recent failure */
-    unsigned int fail_line;
-    const char *fail_file;
-    const char *msg;
+    /* the test being run on the main thread */
+    itest_test_ctx test;
+
+    /* event counters for -P, opened by the first test to need them;
+       perf_state is 0 before then, 1 after */
+    unsigned char perf_state;
+    int perf_fd[ITEST_PERF_EVENTS];
+
+    /* tests with the highest resource usage, for -R; and the read calls
+       made, and bytes read, by the runner itself, which are not
+       charged to tests */
+    itest_usage_top usage_top[ITEST_USAGE_METRICS][ITEST_USAGE_TOP_N];
+    unsigned long long own_reads;
+    unsigned long long own_read_bytes;
+
+    /* assertion counts by call site, for -A: an open-addressed hash
+       table of ITEST_ASSERT_SITES entries, allocated by the first test
+       to need it, and the number of assertions that didn't fit */
+    itest_assert_site *sites;
+    unsigned long sites_lost;
+
+    /* sampling profiler, for --profile: where to write the stacks, how
+       often to sample, and the samples taken during the current test
+       (prof_count may exceed ITEST_PROFILE_SAMPLES, if some had to be
+       dropped) */
+    const char *profile_dir;
+    unsigned int profile_hz;
+    unsigned long long prof_begin;
+    unsigned long long prof_end;
+    void **prof_frames; /* ITEST_PROFILE_DEPTH per sample */
+    int *prof_depth;
+    unsigned int prof_count;
+    unsigned long long prof_ns; /* time spent taking samples */
+
+    /* timeline, for --trace: spans not yet written out, and their
+       names, one after another */
+    const char *trace_path;
+    FILE *trace_fp;
+    itest_trace_event *trace;
+    size_t trace_len;
+    size_t trace_size;
+    char *trace_names;
+    size_t trace_names_len;
+    size_t trace_names_size;
+    unsigned int trace_max_tid;
+    unsigned long long wall_begin; /* when the run began */
+
+    /* --seed: the run seed, hashed with a test's name to seed its
+       random streams; and whether any test has used one, so that the
+       seed needs reporting */
+    unsigned long long seed;
+    unsigned int rand_used;
+
+    /* golden files rewritten by --update-golden */
+    unsigned int golden_updated;
+
+    /* --prop-seed: replay the property trial with this seed */
+    unsigned long long prop_seed;
+    unsigned char prop_replay;
+
+    /* where assertions made during property trials print the details
+       of their failures, instead of out; NULL until needed */
+    FILE *quiet_out;
+
+    /* thread pool: number of workers, and tests waiting to run on it */
+    unsigned int jobs;
+    size_t pool_first_fail; /* index of first queued test to fail */
+    unsigned int pool_running; /* set while the queue is being run */
+    itest_job *queue;
+    size_t queue_len;
+    size_t queue_size;
 
     /* output to this file */
     FILE *out;
@@ -137,20 +606,53 @@ typedef struct itest_run_info
     const char *test_filter;
     const char *test_exclude;
     const char *name_suffix; /* print suffix with test name */
+
+    /* the full name of the test being run on the main thread, built
+       from test_name and the suffix or case by itest_test_name the
+       first time it is needed, which sets name_ready */
+    const char *test_name;
     char name_buf[ITEST_TESTNAME_BUF_SIZE];
+    unsigned char name_ready;
+
+    /* the case of ITEST_RUN_TABLE being run, if in_table is set; its
+       name is only looked up when the test's full name is needed */
+    itest_case_name_cb *case_name_cb;
+    const void *case_ptr;
+    size_t case_index;
+    unsigned char in_table;
+    char case_index_buf[24];
 
     struct itest_prng prng[2]; /* 0: suites, 1: tests */
 
     /* overall timers */
     clock_t begin;
     clock_t end;
-
-    jmp_buf jump_dest;
 } itest_run_info;
 
 /* Global var for the current testing context.  */
 static itest_run_info itest_info;
 
+/* The test being executed by the calling thread, if any.  NULL in
+   helper threads started by a test.  */
+static ITEST_THREAD_LOCAL itest_test_ctx *itest_cur;
+
+/* The test a helper thread belongs to, if it said so with
+   itest_adopt_test; otherwise NULL.  */
+static ITEST_THREAD_LOCAL itest_test_ctx *itest_owner;
+
+/* Assertions made by the calling thread with ITEST_INLINE_ASSERTS, not
+   yet added to itest_info.assertions.  */
+ITEST_THREAD_LOCAL unsigned long itest_inline_assertions;
+
+/* The message most recently formatted by the calling thread for
+   ITEST_FAILf and friends.  It is copied into the test it belongs to
+   before the thread moves on.  */
+static ITEST_THREAD_LOCAL char itest_fmt_buf[ITEST_MESSAGE_BUF_SIZE];
+
+/* Set while the calling thread runs a property trial, whose failures
+   are not reported.  */
+static ITEST_THREAD_LOCAL unsigned char itest_quiet;
+
 /* PRNG internal state assumes uint32_t values */
 static_assert(sizeof(itest_info.prng[0].state) >= 4, "PRNG state too small");
 static_assert(sizeof(itest_info.prng[0].a) >= 4, "PRNG state too small");
@@ -159,6 +661,50 @@ static_assert(sizeof(itest_info.prng[0].m) >= 4, "PRNG state too small");
 
 /* Functions */
 
+static void
+itest_buffer_test_name(const char *name)
+{
+    struct itest_run_info *g = &itest_info;
+    size_t len = strlen(name), size = sizeof(g->name_buf);
+    if (g->in_table) {
+        if (g->case_name_cb != NULL) {
+            g->name_suffix = g->case_name_cb(g->case_ptr);
+        } else {
+            snprintf(g->case_index_buf, sizeof g->case_index_buf, "%lu",
+                     (unsigned long)g->case_index);
+            g->name_suffix = g->case_index_buf;
+        }
+    }
+    memset(g->name_buf, 0x00, size);
+    (void)strncat(g->name_buf, name, size - 1);
+    if (g->name_suffix && (len + 1 < size)) {
+        size_t n = strlen(g->name_suffix);
+        if (n > size - (len + 2)) {
+            n = size - (len + 2); /* truncated to fit, like the name */
+        }
+        g->name_buf[len] = '_';
+        memcpy(&g->name_buf[len + 1], g->name_suffix, n);
+        g->name_buf[len + 1 + n] = '\0';
+    }
+}
+
+/* Return NAME, or if it is NULL, the full name of the test being run on
+   the main thread, built the first time it is asked for.  Passing tests
+   in a long table of cases are usually never named.  */
+static const char *
+itest_test_name(const char *name)
+{
+    struct itest_run_info *g = &itest_info;
+    if (name != NULL) {
+        return name;
+    }
+    if (!g->name_ready) {
+        itest_buffer_test_name(g->test_name);
+        g->name_ready = 1;
+    }
+    return g->name_buf;
+}
+
 /* Query a CPU time clock.  */
 static clock_t
 itest_get_cpu_time(void)
@@ -173,328 +719,4488 @@ itest_get_cpu_time(void)
     return res;
 }
 
-/* Report an elapsed CPU time interval.  */
-static void
-itest_report_interval(clock_t begin, clock_t end)
+/* Query the CPU time used by the calling thread, in the same units as
+   itest_get_cpu_time, or the whole process if that is unavailable.  */
+static clock_t
+itest_get_thread_cpu_time(void)
 {
+#if ITEST_USE_PTHREADS && defined _POSIX_THREAD_CPUTIME                    \
+    && _POSIX_THREAD_CPUTIME >= 0
     if (itest_get_flag(ITEST_FLAG_RECORD_TIMING)) {
-        // This subtraction must be done in unsigned arithmetic lest it
-        // produce nonsense when the timer wraps around.
-        unsigned long delta = (unsigned long)end - (unsigned long)begin;
-        fprintf(itest_info.out, " (%lu ticks, %.3f sec)", delta,
-                ((double)delta) / CLOCKS_PER_SEC);
+        struct timespec ts;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+            return (clock_t)((double)ts.tv_sec * CLOCKS_PER_SEC
+                             + (double)ts.tv_nsec * CLOCKS_PER_SEC / 1e9);
+        }
     }
+#endif
+    return itest_get_cpu_time();
 }
 
-static int
-itest_string_equal_cb(const void *exp, const void *got, void *udata)
+/* Query a monotonic wall clock, in nanoseconds.  */
+static unsigned long long
+itest_get_wall_time_ns(void)
 {
-    size_t *size = (size_t *)udata;
-    return (size != NULL
-                ? (0 == strncmp((const char *)exp, (const char *)got, *size))
-                : (0 == strcmp((const char *)exp, (const char *)got)));
+    struct timespec ts;
+#if defined _POSIX_TIMERS && _POSIX_TIMERS > 0 && defined CLOCK_MONOTONIC
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+        return (unsigned long long)ts.tv_sec * 1000000000u
+               + (unsigned long long)ts.tv_nsec;
+    }
+#endif
+    if (timespec_get(&ts, TIME_UTC) == TIME_UTC) {
+        return (unsigned long long)ts.tv_sec * 1000000000u
+               + (unsigned long long)ts.tv_nsec;
+    }
+    return (unsigned long long)((double)clock() * 1e9 / CLOCKS_PER_SEC);
 }
 
-static int
-itest_string_fprintf_cb(FILE *fp, const void *t, void *udata)
+/* Count the CPUs available to this process; 1 if unknown.  */
+static unsigned int
+itest_cpu_count(void)
 {
-    (void)udata; /* note: does not check \0 termination. */
-    return fprintf(fp, "%s", (const char *)t);
+#if ITEST_USE_PTHREADS && defined _SC_NPROCESSORS_ONLN
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu > 0) {
+        return (unsigned int)ncpu;
+    }
+#endif
+    return 1;
 }
 
-static const itest_type_info itest_type_info_string = {
-    itest_string_equal_cb,
-    itest_string_fprintf_cb,
-};
-
-static int
-itest_memory_equal_cb(const void *exp, const void *got, void *udata)
+/* Ticks elapsed between two CPU times.  This subtraction must be done
+   in unsigned arithmetic lest it produce nonsense when the timer wraps
+   around.  */
+static unsigned long
+itest_ticks(clock_t begin, clock_t end)
 {
-    itest_memory_cmp_env *env = (itest_memory_cmp_env *)udata;
-    return (0 == memcmp(exp, got, env->size));
+    return (unsigned long)end - (unsigned long)begin;
 }
 
-/* Hexdump raw memory, with differences highlighted */
-static int
-itest_memory_fprintf_cb(FILE *fp, const void *t, void *udata)
+/* Report an elapsed CPU time interval, and if FIXTURE is set, how much
+   of it went to setup hooks, test bodies, and teardown hooks.  */
+static void
+itest_report_phases(clock_t begin, clock_t end, int fixture,
+                    unsigned long setup, unsigned long body,
+                    unsigned long teardown)
 {
-    itest_memory_cmp_env *env = (itest_memory_cmp_env *)udata;
-    const unsigned char *buf  = (const unsigned char *)t;
-    unsigned char diff_mark;
-    size_t i, line_i, line_len = 0;
-    int len = 0; /* format hexdump with differences highlighted */
-    for (i = 0; i < env->size; i += line_len) {
-        diff_mark = ' ';
-        line_len  = env->size - i;
-        if (line_len > 16) {
-            line_len = 16;
-        }
-        for (line_i = i; line_i < i + line_len; line_i++) {
-            if (env->exp[line_i] != env->got[line_i]) {
-                diff_mark = 'X';
-            }
-        }
-        len += fprintf(fp, "\n%04x %c ", (unsigned int)i, diff_mark);
-        for (line_i = i; line_i < i + line_len; line_i++) {
-            int m = env->exp[line_i] == env->got[line_i]; /* match? */
-            len += fprintf(fp, "%02x%c", buf[line_i], m ? ' ' : '<');
-        }
-        for (line_i = 0; line_i < 16 - line_len; line_i++) {
-            len += fprintf(fp, "   ");
-        }
-        fprintf(fp, " ");
-        for (line_i = i; line_i < i + line_len; line_i++) {
-            unsigned char c = buf[line_i];
-            len += fprintf(fp, "%c", isprint(c) ? c : '.');
+    if (itest_get_flag(ITEST_FLAG_RECORD_TIMING)) {
+        unsigned long delta = itest_ticks(begin, end);
+        fprintf(itest_info.out, " (%lu ticks, %.3f sec", delta,
+                ((double)delta) / CLOCKS_PER_SEC);
+        if (fixture) {
+            fprintf(itest_info.out, "; setup %lu, body %lu, teardown %lu",
+                    setup, body, teardown);
         }
+        fprintf(itest_info.out, ")");
     }
-    len += fprintf(fp, "\n");
-    return len;
 }
 
-static const itest_type_info itest_type_info_memory = {
-    itest_memory_equal_cb,
-    itest_memory_fprintf_cb,
+/* Report an elapsed CPU time interval.  */
+static void
+itest_report_interval(clock_t begin, clock_t end)
+{
+    itest_report_phases(begin, end, 0, 0, 0, 0);
+}
+
+/* Events counted by the -P switch.  Hardware events are preferred;
+   task-clock stands in for them if none are available.  */
+static const struct itest_perf_event
+{
+    const char *name;
+    unsigned int type;
+    unsigned long long config;
+} itest_perf_events[ITEST_PERF_EVENTS] = {
+#if ITEST_USE_PERF_EVENT
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "task-clock-ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { "context-switches", PERF_TYPE_SOFTWARE,
+      PERF_COUNT_SW_CONTEXT_SWITCHES },
+#else
+    { NULL, 0, 0 },
+#endif
 };
 
-/* Is FILTER a subset of NAME? */
-static int
-itest_name_match(const char *name, const char *filter, int res_if_none)
+/* Open the event counters for the calling thread, if that hasn't been
+   tried already.  */
+static void
+itest_perf_open(void)
 {
-    size_t offset     = 0;
-    size_t filter_len = filter ? strlen(filter) : 0;
-    if (filter_len == 0) {
-        return res_if_none;
-    } /* no filter */
-    if (itest_info.exact_name_match && strlen(name) != filter_len) {
-        return 0; /* ignore substring matches */
+    struct itest_run_info *g = &itest_info;
+    size_t i;
+    int any = 0;
+#if ITEST_USE_PERF_EVENT
+    int hw = 0;
+#endif
+    if (g->perf_state != 0) {
+        return;
     }
-    while (name[offset] != '\0') {
-        if (name[offset] == filter[0]) {
-            if (0 == strncmp(&name[offset], filter, filter_len)) {
-                return 1;
+    g->perf_state = 1;
+    for (i = 0; i < ITEST_PERF_EVENTS; i++) {
+        g->perf_fd[i] = -1;
+#if ITEST_USE_PERF_EVENT
+        {
+            const struct itest_perf_event *ev = &itest_perf_events[i];
+            struct perf_event_attr attr;
+            if (ev->config == PERF_COUNT_SW_TASK_CLOCK
+                && ev->type == PERF_TYPE_SOFTWARE && hw) {
+                continue;
+            }
+            memset(&attr, 0, sizeof attr);
+            attr.size           = sizeof attr;
+            attr.type           = ev->type;
+            attr.config         = ev->config;
+            attr.exclude_kernel = 1; /* allowed at perf_event_paranoid 2 */
+            attr.exclude_hv     = 1;
+            attr.inherit        = 1; /* count threads the test starts */
+            g->perf_fd[i] =
+                (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (g->perf_fd[i] >= 0) {
+                any = 1;
+                hw |= ev->type == PERF_TYPE_HARDWARE;
             }
         }
-        offset++;
+#endif
+    }
+    if (!any) {
+        fprintf(itest_info.out, "Event counters unavailable: %s\n",
+                ITEST_USE_PERF_EVENT ? strerror(errno) : "not supported");
     }
-
-    return 0;
 }
 
+/* Close the event counters, if they are open.  */
 static void
-itest_buffer_test_name(const char *name)
+itest_perf_close(void)
 {
-    struct itest_run_info *g = &itest_info;
-    size_t len = strlen(name), size = sizeof(g->name_buf);
-    memset(g->name_buf, 0x00, size);
-    (void)strncat(g->name_buf, name, size - 1);
-    if (g->name_suffix && (len + 1 < size)) {
-        g->name_buf[len] = '_';
-        strncat(&g->name_buf[len + 1], g->name_suffix, size - (len + 2));
+    size_t i;
+    if (itest_info.perf_state == 0) {
+        return;
     }
-}
-
+    for (i = 0; i < ITEST_PERF_EVENTS; i++) {
+#if ITEST_USE_PERF_EVENT
+        if (itest_info.perf_fd[i] >= 0) {
+            close(itest_info.perf_fd[i]);
+        }
+#endif
+        itest_info.perf_fd[i] = -1;
+    }
+}
+
+#if ITEST_USE_FORK
+/* Open the event counters again in a forked child, if the parent had
+   any: the parent's count the parent.  */
+static void
+itest_perf_reopen(void)
+{
+    size_t i;
+    for (i = 0; i < ITEST_PERF_EVENTS; i++) {
+        if (itest_info.perf_state != 0 && itest_info.perf_fd[i] >= 0) {
+            itest_perf_close();
+            itest_info.perf_state = 0;
+            itest_perf_open();
+            return;
+        }
+    }
+}
+#endif
+
+/* Read the event counters into V, if -P is in effect.  Returns 1 if
+   any counter could be read.  The counters follow the main thread and
+   any threads it starts, once those have exited; tests run on the
+   thread pool are not counted separately.  */
+static int
+itest_perf_read(unsigned long long *v)
+{
+    size_t i;
+    int any = 0;
+    if (!itest_get_flag(ITEST_FLAG_PERF_COUNTERS)) {
+        return 0;
+    }
+    itest_perf_open();
+    for (i = 0; i < ITEST_PERF_EVENTS; i++) {
+        v[i] = 0;
+#if ITEST_USE_PERF_EVENT
+        if (itest_info.perf_fd[i] >= 0) {
+            ssize_t n = read(itest_info.perf_fd[i], &v[i], sizeof v[i]);
+            itest_info.own_reads++;
+            itest_info.own_read_bytes += n > 0 ? (unsigned long long)n : 0;
+            any |= n == (ssize_t)sizeof v[i];
+        }
+#endif
+    }
+    return any;
+}
+
+/* Report the events counted while running test T.  */
+static void
+itest_report_counters(const itest_test_ctx *t)
+{
+    const char *sep = " [";
+    size_t i;
+    if (!t->perf_valid) {
+        return;
+    }
+    for (i = 0; i < ITEST_PERF_EVENTS; i++) {
+        if (itest_info.perf_fd[i] >= 0) {
+            fprintf(itest_info.out, "%s%s %llu", sep,
+                    itest_perf_events[i].name,
+                    t->perf_post[i] - t->perf_pre[i]);
+            sep = ", ";
+        }
+    }
+    /* instructions per cycle, if both were counted */
+    if (itest_info.perf_fd[0] >= 0 && itest_info.perf_fd[1] >= 0
+        && t->perf_post[1] != t->perf_pre[1]) {
+        fprintf(itest_info.out, ", IPC %.2f",
+                (double)(t->perf_post[0] - t->perf_pre[0])
+                    / (double)(t->perf_post[1] - t->perf_pre[1]));
+    }
+    if (sep[0] == ',') {
+        fprintf(itest_info.out, "]");
+    }
+}
+
+/* Resource usage metrics recorded by the -R switch, in the order
+   itest_usage_read stores them.  */
+static const char *const itest_usage_names[ITEST_USAGE_METRICS] = {
+    "max-rss-kb",  "minor-faults", "major-faults",
+    "vol-switches", "invol-switches", "read-calls",
+    "write-calls", "read-bytes",   "write-bytes",
+};
+
+/* Read the resource usage of the whole process into V, if -R is in
+   effect.  Returns 1 if it did.  The read and write counts come from
+   /proc/self/io, and are left at 0 where that doesn't exist; reads made
+   by the runner itself, including of that file, are left out.  */
+static int
+itest_usage_read(unsigned long long *v)
+{
+    if (!itest_get_flag(ITEST_FLAG_RUSAGE)) {
+        return 0;
+    }
+    memset(v, 0, ITEST_USAGE_METRICS * sizeof *v);
+#if ITEST_USE_RUSAGE
+    {
+        struct rusage ru;
+        if (getrusage(RUSAGE_SELF, &ru) == 0) {
+            v[0] = (unsigned long long)ru.ru_maxrss;
+#    if defined __APPLE__
+            v[0] /= 1024; /* bytes, not kilobytes */
+#    endif
+            v[1] = (unsigned long long)ru.ru_minflt;
+            v[2] = (unsigned long long)ru.ru_majflt;
+            v[3] = (unsigned long long)ru.ru_nvcsw;
+            v[4] = (unsigned long long)ru.ru_nivcsw;
+        }
+    }
+#endif
+#if defined __linux__
+    {
+        static const char *const keys[] = { "syscr", "syscw", "rchar",
+                                            "wchar" };
+        char buf[512];
+        size_t len = 0, i;
+        unsigned long long calls = 0;
+        ssize_t n;
+        int fd = open("/proc/self/io", O_RDONLY);
+        if (fd < 0) {
+            return 1;
+        }
+        do {
+            n = read(fd, buf + len, sizeof buf - 1 - len);
+            calls++;
+            len += n > 0 ? (size_t)n : 0;
+        } while (n > 0 && len < sizeof buf - 1);
+        close(fd);
+        buf[len] = '\0';
+        for (i = 0; i < sizeof keys / sizeof keys[0]; i++) {
+            const char *p = strstr(buf, keys[i]);
+            if (p != NULL && p[strlen(keys[i])] == ':') {
+                v[5 + i] = strtoull(p + strlen(keys[i]) + 1, NULL, 10);
+            }
+        }
+        /* the figures were taken as the first read began */
+        v[5] -= itest_info.own_reads;
+        v[7] -= itest_info.own_read_bytes;
+        itest_info.own_reads += calls;
+        itest_info.own_read_bytes += len;
+    }
+#endif
+    return 1;
+}
+
+/* The change in resource usage metric I while running test T.  */
+static unsigned long long
+itest_usage_delta(const itest_test_ctx *t, size_t i)
+{
+    return t->usage_post[i] - t->usage_pre[i];
+}
+
+/* Remember the resource usage of test T, as NAME, for the summary at
+   the end of the run.  */
+static void
+itest_record_usage(const itest_test_ctx *t, const char *name)
+{
+    size_t i, j;
+    if (!t->usage_valid) {
+        return;
+    }
+    for (i = 0; i < ITEST_USAGE_METRICS; i++) {
+        itest_usage_top *top = itest_info.usage_top[i];
+        unsigned long long d = itest_usage_delta(t, i);
+        for (j = 0; j < ITEST_USAGE_TOP_N && top[j].value >= d; j++) {
+        }
+        if (j < ITEST_USAGE_TOP_N) {
+            memmove(&top[j + 1], &top[j],
+                    (ITEST_USAGE_TOP_N - j - 1) * sizeof top[0]);
+            top[j].value = d;
+            snprintf(top[j].name, sizeof top[j].name, "%s",
+                     itest_test_name(name));
+        }
+    }
+}
+
+/* Report the resource usage of test T.  Only nonzero deltas are
+   printed.  */
+static void
+itest_report_usage(const itest_test_ctx *t)
+{
+    const char *sep = " {";
+    size_t i;
+    if (!t->usage_valid) {
+        return;
+    }
+    for (i = 0; i < ITEST_USAGE_METRICS; i++) {
+        unsigned long long d = itest_usage_delta(t, i);
+        if (d != 0) {
+            fprintf(itest_info.out, "%s%s %llu", sep, itest_usage_names[i],
+                    d);
+            sep = ", ";
+        }
+    }
+    if (sep[0] == ',') {
+        fprintf(itest_info.out, "}");
+    }
+}
+
+/* Print the tests with the highest value of each resource usage
+   metric.  */
+static void
+itest_report_usage_summary(void)
+{
+    size_t i, j;
+    fprintf(itest_info.out, "\nHighest resource usage:\n");
+    for (i = 0; i < ITEST_USAGE_METRICS; i++) {
+        const itest_usage_top *top = itest_info.usage_top[i];
+        if (top[0].value == 0) {
+            continue;
+        }
+        fprintf(itest_info.out, "  %s:", itest_usage_names[i]);
+        for (j = 0; j < ITEST_USAGE_TOP_N && top[j].value != 0; j++) {
+            fprintf(itest_info.out, "%s %s %llu", j > 0 ? "," : "",
+                    top[j].name, top[j].value);
+        }
+        fprintf(itest_info.out, "\n");
+    }
+}
+
+/* Allocate the table of assertion call sites, if -A is in effect and
+   it hasn't been already.  Called on the main thread before running or
+   queueing a test.  */
+static void
+itest_sites_alloc(void)
+{
+    struct itest_run_info *g = &itest_info;
+    if (g->sites == NULL && itest_get_flag(ITEST_FLAG_ASSERT_SITES)) {
+        g->sites = (itest_assert_site *)calloc(ITEST_ASSERT_SITES,
+                                               sizeof(itest_assert_site));
+    }
+}
+
+/* Count N assertions made at FILE:LINE, if -A is in effect.  Safe to
+   call from any thread: slots are claimed with compare-and-swap, and
+   never released until the end of the run.  */
+static void
+itest_sites_add(const char *file, unsigned int line, unsigned long n)
+{
+    itest_assert_site *sites = itest_info.sites;
+    size_t h, i;
+    if (sites == NULL) {
+        return;
+    }
+    h = ((size_t)file >> 3) * 31u + line;
+    h ^= h >> 7;
+    for (i = 0; i < ITEST_ASSERT_SITES; i++) {
+        itest_assert_site *s = &sites[(h + i) % ITEST_ASSERT_SITES];
+        const char *f        = ITEST_ATOMIC_LOAD(&s->file);
+        if (f == NULL && ITEST_ATOMIC_CAS(&s->file, &f, file)) {
+            s->line = line;
+            ITEST_ATOMIC_STORE(&s->ready, 1u);
+            f = file;
+        } else {
+            while (!ITEST_ATOMIC_LOAD(&s->ready)) {
+            }
+        }
+        if (f == file && s->line == line) {
+            ITEST_ATOMIC_FETCH_ADD(&s->count, n);
+            ITEST_ATOMIC_FETCH_ADD(&s->test_count, n);
+            return;
+        }
+    }
+    ITEST_ATOMIC_FETCH_ADD(&itest_info.sites_lost, n);
+}
+
+/* Count an assertion made at FILE:LINE, if -A is in effect.  */
+static void
+itest_count_assert(const char *file, unsigned int line)
+{
+    itest_sites_add(file, line, 1ul);
+}
+
+/* Forget the per-test assertion counts, before running a test on the
+   main thread.  */
+static void
+itest_sites_reset(itest_test_ctx *t)
+{
+    itest_assert_site *sites = itest_info.sites;
+    size_t i;
+    t->sites_valid = sites != NULL;
+    if (sites == NULL) {
+        return;
+    }
+    for (i = 0; i < ITEST_ASSERT_SITES; i++) {
+        sites[i].test_count = 0;
+    }
+}
+
+/* Copy the ITEST_ASSERT_SITES_TOP_N call sites with the highest count
+   (or test_count, if PER_TEST is set) into TOP, most frequent first,
+   with the relevant count in TOP[i].count.  Unused entries of TOP are
+   left with a count of 0.  */
+static void
+itest_sites_top(itest_assert_site *top, int per_test)
+{
+    const itest_assert_site *sites = itest_info.sites;
+    size_t i, j;
+    memset(top, 0, ITEST_ASSERT_SITES_TOP_N * sizeof *top);
+    if (sites == NULL) {
+        return;
+    }
+    for (i = 0; i < ITEST_ASSERT_SITES; i++) {
+        unsigned long n = per_test ? sites[i].test_count : sites[i].count;
+        if (n == 0) {
+            continue;
+        }
+        for (j = 0; j < ITEST_ASSERT_SITES_TOP_N && top[j].count >= n; j++) {
+        }
+        if (j < ITEST_ASSERT_SITES_TOP_N) {
+            memmove(&top[j + 1], &top[j],
+                    (ITEST_ASSERT_SITES_TOP_N - j - 1) * sizeof top[0]);
+            top[j]       = sites[i];
+            top[j].count = n;
+        }
+    }
+}
+
+/* Print the call sites in TOP, as a comma-separated list.  */
+static void
+itest_print_sites(const itest_assert_site *top)
+{
+    size_t i;
+    for (i = 0; i < ITEST_ASSERT_SITES_TOP_N && top[i].count != 0; i++) {
+        fprintf(itest_info.out, "%s %s:%u %lu", i > 0 ? "," : "",
+                top[i].file, top[i].line, top[i].count);
+    }
+}
+
+/* Report the assertion call sites test T reached most often.  */
+static void
+itest_report_sites(const itest_test_ctx *t)
+{
+    if (!t->sites_valid || t->sites_top[0].count == 0) {
+        return;
+    }
+    fprintf(itest_info.out, "    assertions:");
+    itest_print_sites(t->sites_top);
+    fprintf(itest_info.out, "\n");
+}
+
+/* Print the assertion call sites reached most often during the whole
+   run.  */
+static void
+itest_report_sites_summary(void)
+{
+    itest_assert_site top[ITEST_ASSERT_SITES_TOP_N];
+    itest_sites_top(top, 0);
+    fprintf(itest_info.out, "\nMost frequent assertions:");
+    itest_print_sites(top);
+    fprintf(itest_info.out, "\n");
+    if (itest_info.sites_lost != 0) {
+        fprintf(itest_info.out,
+                "(%lu assertions not counted: more than %u call sites)\n",
+                itest_info.sites_lost, (unsigned int)ITEST_ASSERT_SITES);
+    }
+}
+
+#if ITEST_USE_PROFILER
+/* SIGPROF handler: record the stack of the interrupted code.  */
+static void
+itest_prof_handler(int sig)
+{
+    struct itest_run_info *g = &itest_info;
+    int saved_errno          = errno;
+    unsigned long long start = itest_get_wall_time_ns();
+    unsigned int i           = ITEST_ATOMIC_FETCH_ADD(&g->prof_count, 1u);
+    (void)sig;
+    if (i < ITEST_PROFILE_SAMPLES) {
+        g->prof_depth[i] = backtrace(&g->prof_frames[i * ITEST_PROFILE_DEPTH],
+                                     ITEST_PROFILE_DEPTH);
+    }
+    ITEST_ATOMIC_FETCH_ADD(&g->prof_ns, itest_get_wall_time_ns() - start);
+    errno = saved_errno;
+}
+
+/* Order samples I and J by their stacks, so that identical stacks are
+   adjacent.  */
+static int
+itest_prof_cmp(const void *a, const void *b)
+{
+    const struct itest_run_info *g = &itest_info;
+    unsigned int i = *(const unsigned int *)a, j = *(const unsigned int *)b;
+    if (g->prof_depth[i] != g->prof_depth[j]) {
+        return g->prof_depth[i] < g->prof_depth[j] ? -1 : 1;
+    }
+    return memcmp(&g->prof_frames[i * ITEST_PROFILE_DEPTH],
+                  &g->prof_frames[j * ITEST_PROFILE_DEPTH],
+                  (size_t)g->prof_depth[i] * sizeof(void *));
+}
+
+/* Write one stack of the folded-stack format to FP, outermost frame
+   first: function names where backtrace_symbols knows them, and
+   file+offset otherwise.  */
+static void
+itest_prof_write_stack(FILE *fp, void **frames, int depth)
+{
+    char **syms = backtrace_symbols(frames, depth);
+    int k;
+    for (k = depth - 1; k >= 0; k--) {
+        const char *sym = syms ? syms[k] : NULL;
+        const char *open = sym ? strchr(sym, '(') : NULL;
+        size_t len = open ? strcspn(open + 1, "+)") : 0;
+        if (k != depth - 1) {
+            fputc(';', fp);
+        }
+        if (len > 0) {
+            fprintf(fp, "%.*s", (int)len, open + 1);
+        } else if (open != NULL) {
+            const char *base = strrchr(sym, '/');
+            base             = base && base < open ? base + 1 : sym;
+            fprintf(fp, "%.*s%.*s", (int)(open - base), base,
+                    (int)strcspn(open + 1, ")"), open + 1);
+        } else {
+            fprintf(fp, "%p", frames[k]);
+        }
+    }
+    free(syms);
+}
+
+/* Write the samples taken during the current test to PATH, merging
+   identical stacks.  Returns 0 on failure.  */
+static int
+itest_prof_write(const char *path)
+{
+    struct itest_run_info *g = &itest_info;
+    unsigned int n           = g->prof_count, i, j, *order;
+    int ok;
+    FILE *fp;
+    if (n > ITEST_PROFILE_SAMPLES) {
+        n = ITEST_PROFILE_SAMPLES;
+    }
+    order = (unsigned int *)malloc((n ? n : 1) * sizeof *order);
+    if (order == NULL) {
+        return 0;
+    }
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+        free(order);
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    qsort(order, n, sizeof *order, itest_prof_cmp);
+    for (i = 0; i < n; i = j) {
+        /* The two innermost frames are this handler and the signal
+           trampoline.  */
+        void **frames = &g->prof_frames[order[i] * ITEST_PROFILE_DEPTH];
+        int depth     = g->prof_depth[order[i]];
+        for (j = i + 1; j < n && itest_prof_cmp(&order[i], &order[j]) == 0;
+             j++) {
+        }
+        if (depth > 2) {
+            itest_prof_write_stack(fp, frames + 2, depth - 2);
+            fprintf(fp, " %u\n", j - i);
+        }
+    }
+    free(order);
+    ok = !ferror(fp);
+    return fclose(fp) == 0 && ok;
+}
+#endif
+
+/* Start sampling the stack, if --profile is in effect.  The timer
+   counts the CPU time of the whole process, so this is only done for
+   tests run on the main thread, while no pool job can be running.  */
+static void
+itest_prof_start(void)
+{
+#if ITEST_USE_PROFILER
+    struct itest_run_info *g = &itest_info;
+    struct sigaction sa;
+    struct itimerval it;
+    if (g->profile_dir == NULL) {
+        return;
+    }
+    if (g->prof_frames == NULL) {
+        g->prof_frames = (void **)calloc(
+            (size_t)ITEST_PROFILE_SAMPLES * ITEST_PROFILE_DEPTH,
+            sizeof(void *));
+        g->prof_depth =
+            (int *)calloc(ITEST_PROFILE_SAMPLES, sizeof *g->prof_depth);
+        if (g->prof_frames == NULL || g->prof_depth == NULL) {
+            free(g->prof_frames);
+            free(g->prof_depth);
+            g->prof_frames = NULL;
+            g->prof_depth  = NULL;
+            return;
+        }
+        /* The first call to backtrace may load libraries, which must not
+           happen in a signal handler.  */
+        backtrace(g->prof_frames, 1);
+    }
+    g->prof_count = 0;
+    g->prof_ns    = 0;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = itest_prof_handler;
+    sa.sa_flags   = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, NULL);
+    memset(&it, 0, sizeof it);
+    it.it_interval.tv_usec = (suseconds_t)(1000000 / g->profile_hz);
+    if (it.it_interval.tv_usec == 0) {
+        it.it_interval.tv_usec = 1;
+    }
+    it.it_value   = it.it_interval;
+    g->prof_begin = itest_get_wall_time_ns();
+    setitimer(ITIMER_PROF, &it, NULL);
+#endif
+}
+
+/* Stop sampling the stack, if --profile is in effect.  */
+static void
+itest_prof_stop(void)
+{
+#if ITEST_USE_PROFILER
+    struct itest_run_info *g = &itest_info;
+    struct itimerval it;
+    if (g->profile_dir == NULL || g->prof_frames == NULL) {
+        return;
+    }
+    memset(&it, 0, sizeof it);
+    setitimer(ITIMER_PROF, &it, NULL);
+    g->prof_end = itest_get_wall_time_ns();
+    signal(SIGPROF, SIG_IGN); /* in case one is still pending */
+#endif
+}
+
+#if ITEST_USE_PROFILER
+/* Put the name of the file for the stacks sampled during test NAME in
+   PATH, of SIZE bytes.  */
+static void
+itest_prof_path(char *path, size_t size, const char *name)
+{
+    const struct itest_run_info *g = &itest_info;
+    size_t len = (size_t)snprintf(path, size, "%s/", g->profile_dir);
+    size_t i;
+    if (len < size) {
+        size_t start = len;
+        snprintf(path + len, size - len, "%s%s%s.folded",
+                 g->suite.name ? g->suite.name : "",
+                 g->suite.name ? "." : "", itest_test_name(name));
+        /* keep the test name from making subdirectories */
+        for (i = start; path[i] != '\0'; i++) {
+            if (!isalnum((unsigned char)path[i]) && path[i] != '.'
+                && path[i] != '-') {
+                path[i] = '_';
+            }
+        }
+    }
+}
+#endif
+
+/* Write the stacks sampled during test NAME to the --profile directory.
+   Returns 0 if it did, -1 if there was nothing to write, or else the
+   errno value for the failure.  */
+static int
+itest_prof_save(const char *name)
+{
+#if ITEST_USE_PROFILER
+    char path[FILENAME_MAX];
+    if (itest_info.profile_dir == NULL || itest_info.prof_frames == NULL) {
+        return -1;
+    }
+    itest_prof_path(path, sizeof path, name);
+    return itest_prof_write(path) ? 0 : errno ? errno : EIO;
+#else
+    (void)name;
+    return -1;
+#endif
+}
+
+/* Report ERR, as returned by itest_prof_save for test NAME, and in
+   verbose mode, how many stacks were sampled and what taking them
+   cost.  */
+static void
+itest_prof_note(const char *name, int err)
+{
+#if ITEST_USE_PROFILER
+    struct itest_run_info *g = &itest_info;
+    char path[FILENAME_MAX];
+    if (err < 0) {
+        return;
+    }
+    itest_prof_path(path, sizeof path, name);
+    if (err > 0) {
+        fprintf(itest_info.out, "    profile: %s: %s\n", path,
+                strerror(err));
+    } else if (itest_get_verbosity()) {
+        unsigned long long wall = g->prof_end - g->prof_begin;
+        fprintf(itest_info.out, "    profile: %u samples", g->prof_count);
+        if (g->prof_count > ITEST_PROFILE_SAMPLES) {
+            fprintf(itest_info.out, " (%u dropped)",
+                    g->prof_count - ITEST_PROFILE_SAMPLES);
+        }
+        fprintf(itest_info.out, ", %.2f%% overhead, in %s\n",
+                wall ? 100.0 * (double)g->prof_ns / (double)wall : 0.0,
+                path);
+    }
+#else
+    (void)name;
+    (void)err;
+#endif
+}
+
+/* The wall clock time, if --trace is in effect; otherwise 0.  */
+static unsigned long long
+itest_trace_now(void)
+{
+    return itest_info.trace_path ? itest_get_wall_time_ns() : 0;
+}
+
+/* Add a span, from BEGIN to END, to the timeline.  */
+static void
+itest_trace_add(enum itest_trace_kind kind, const char *name,
+                unsigned long long begin, unsigned long long end,
+                unsigned int tid, int result)
+{
+    struct itest_run_info *g = &itest_info;
+    size_t len               = strlen(name) + 1;
+    itest_trace_event *ev;
+    if (g->trace_path == NULL) {
+        return;
+    }
+    if (g->trace_len == g->trace_size) {
+        size_t size = g->trace_size ? 2 * g->trace_size : 64;
+        void *p     = realloc(g->trace, size * sizeof *g->trace);
+        if (p == NULL) {
+            return;
+        }
+        g->trace      = (itest_trace_event *)p;
+        g->trace_size = size;
+    }
+    if (g->trace_names_size - g->trace_names_len < len) {
+        size_t size = g->trace_names_size ? 2 * g->trace_names_size : 1024;
+        void *p;
+        while (size - g->trace_names_len < len) {
+            size *= 2;
+        }
+        p = realloc(g->trace_names, size);
+        if (p == NULL) {
+            return;
+        }
+        g->trace_names      = (char *)p;
+        g->trace_names_size = size;
+    }
+    ev         = &g->trace[g->trace_len++];
+    ev->begin  = begin > g->wall_begin ? begin - g->wall_begin : 0;
+    ev->end    = end > g->wall_begin ? end - g->wall_begin : 0;
+    ev->name   = g->trace_names_len;
+    ev->tid    = tid;
+    ev->kind   = (unsigned char)kind;
+    ev->result = (unsigned char)result;
+    memcpy(g->trace_names + g->trace_names_len, name, len);
+    g->trace_names_len += len;
+    if (tid > g->trace_max_tid) {
+        g->trace_max_tid = tid;
+    }
+}
+
+/* Add the spans of test T, named NAME, to the timeline.  */
+static void
+itest_trace_test(const itest_test_ctx *t, const char *name, int res)
+{
+    if (itest_info.trace_path == NULL) {
+        return;
+    }
+    itest_trace_add(ITEST_TRACE_TEST, itest_test_name(name), t->wall_pre_test,
+                    t->wall_post_test, t->worker, res);
+    if (t->has_fixture) {
+        itest_trace_add(ITEST_TRACE_SETUP, "setup", t->wall_pre_test,
+                        t->wall_pre_body, t->worker, 0);
+        itest_trace_add(ITEST_TRACE_TEARDOWN, "teardown", t->wall_post_body,
+                        t->wall_post_test, t->worker, 0);
+    }
+}
+
+/* Write S to FP as the contents of a JSON string.  */
+static void
+itest_trace_write_str(FILE *fp, const char *s)
+{
+    for (; *s != '\0'; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fprintf(fp, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(fp, "\\u%04x", c);
+        } else {
+            fputc(c, fp);
+        }
+    }
+}
+
+/* Write out the spans added to the timeline since the last call, as
+   Chrome trace-event JSON, opening the file if need be.  */
+static void
+itest_trace_flush(void)
+{
+    static const char *const cats[] = { "run", "suite", "test", "fixture",
+                                        "fixture" };
+    static const char *const results[] = { "pass", "fail", "skip" };
+    struct itest_run_info *g = &itest_info;
+    size_t i;
+    if (g->trace_path == NULL) {
+        return;
+    }
+    if (g->trace_fp == NULL) {
+        g->trace_fp = fopen(g->trace_path, "w");
+        if (g->trace_fp == NULL) {
+            fprintf(itest_info.out, "Cannot write trace to %s: %s\n",
+                    g->trace_path, strerror(errno));
+            g->trace_path = NULL;
+            return;
+        }
+        fprintf(g->trace_fp, "{\"traceEvents\":[\n"
+                             "{\"name\":\"process_name\",\"ph\":\"M\","
+                             "\"pid\":1,\"args\":{\"name\":\"itest\"}}");
+    }
+    for (i = 0; i < g->trace_len; i++) {
+        const itest_trace_event *ev = &g->trace[i];
+        fprintf(g->trace_fp, ",\n{\"name\":\"");
+        itest_trace_write_str(g->trace_fp, g->trace_names + ev->name);
+        fprintf(g->trace_fp,
+                "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":1,\"tid\":%u",
+                cats[ev->kind], (double)ev->begin / 1000.0,
+                (double)(ev->end - ev->begin) / 1000.0, ev->tid);
+        if (ev->kind == ITEST_TRACE_TEST) {
+            fprintf(g->trace_fp, ",\"args\":{\"result\":\"%s\"}",
+                    ev->result < 3 ? results[ev->result] : "fail");
+        }
+        fprintf(g->trace_fp, "}");
+    }
+    fflush(g->trace_fp);
+    g->trace_len       = 0;
+    g->trace_names_len = 0;
+}
+
+/* Finish the timeline with a span for the whole run, and close it.  */
+static void
+itest_trace_close(void)
+{
+    struct itest_run_info *g = &itest_info;
+    unsigned int tid;
+    if (g->trace_path == NULL) {
+        return;
+    }
+    itest_trace_add(ITEST_TRACE_RUN, "run", g->wall_begin,
+                    itest_get_wall_time_ns(), 0, 0);
+    itest_trace_flush();
+    if (g->trace_fp == NULL) {
+        return;
+    }
+    for (tid = 0; tid <= g->trace_max_tid; tid++) {
+        fprintf(g->trace_fp,
+                ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%u,\"args\":{\"name\":\"",
+                tid);
+        if (tid == 0) {
+            fprintf(g->trace_fp, "main\"}}");
+        } else {
+            fprintf(g->trace_fp, "worker %u\"}}", tid);
+        }
+    }
+    fprintf(g->trace_fp, "\n]}\n");
+    fclose(g->trace_fp);
+    g->trace_fp = NULL;
+}
+
+static int
+itest_string_equal_cb(const void *exp, const void *got, void *udata)
+{
+    size_t *size = (size_t *)udata;
+    return (size != NULL
+                ? (0 == strncmp((const char *)exp, (const char *)got, *size))
+                : (0 == strcmp((const char *)exp, (const char *)got)));
+}
+
+static int
+itest_string_fprintf_cb(FILE *fp, const void *t, void *udata)
+{
+    (void)udata; /* note: does not check \0 termination. */
+    return fprintf(fp, "%s", (const char *)t);
+}
+
+static const itest_type_info itest_type_info_string = {
+    itest_string_equal_cb,
+    itest_string_fprintf_cb,
+};
+
+static int
+itest_memory_equal_cb(const void *exp, const void *got, void *udata)
+{
+    itest_memory_cmp_env *env = (itest_memory_cmp_env *)udata;
+    return (0 == memcmp(exp, got, env->size));
+}
+
+/* Hexdump raw memory, with differences highlighted */
+static int
+itest_memory_fprintf_cb(FILE *fp, const void *t, void *udata)
+{
+    itest_memory_cmp_env *env = (itest_memory_cmp_env *)udata;
+    const unsigned char *buf  = (const unsigned char *)t;
+    unsigned char diff_mark;
+    size_t i, line_i, line_len = 0;
+    int len = 0; /* format hexdump with differences highlighted */
+    for (i = 0; i < env->size; i += line_len) {
+        diff_mark = ' ';
+        line_len  = env->size - i;
+        if (line_len > 16) {
+            line_len = 16;
+        }
+        for (line_i = i; line_i < i + line_len; line_i++) {
+            if (env->exp[line_i] != env->got[line_i]) {
+                diff_mark = 'X';
+            }
+        }
+        len += fprintf(fp, "\n%04x %c ", (unsigned int)i, diff_mark);
+        for (line_i = i; line_i < i + line_len; line_i++) {
+            int m = env->exp[line_i] == env->got[line_i]; /* match? */
+            len += fprintf(fp, "%02x%c", buf[line_i], m ? ' ' : '<');
+        }
+        for (line_i = 0; line_i < 16 - line_len; line_i++) {
+            len += fprintf(fp, "   ");
+        }
+        fprintf(fp, " ");
+        for (line_i = i; line_i < i + line_len; line_i++) {
+            unsigned char c = buf[line_i];
+            len += fprintf(fp, "%c", isprint(c) ? c : '.');
+        }
+    }
+    len += fprintf(fp, "\n");
+    return len;
+}
+
+static const itest_type_info itest_type_info_memory = {
+    itest_memory_equal_cb,
+    itest_memory_fprintf_cb,
+};
+
+/* Count the elements of the COUNT-element array GOT that differ from
+   the corresponding element of EXP, or from EXP[0] if ALL is set,
+   comparing them as type T.  The loops are simple enough for the
+   compiler to vectorize.  */
+#define ITEST_COUNT_MISMATCHES(T, exp, all, got, count, n)                   \
+    do {                                                                     \
+        const T *e_ = (const T *)(exp);                                      \
+        const T *g_ = (const T *)(got);                                      \
+        size_t i_;                                                           \
+        if (all) {                                                           \
+            T x_ = e_[0];                                                    \
+            for (i_ = 0; i_ < (count); i_++) {                               \
+                (n) += x_ != g_[i_];                                         \
+            }                                                                \
+        } else {                                                             \
+            for (i_ = 0; i_ < (count); i_++) {                               \
+                (n) += e_[i_] != g_[i_];                                     \
+            }                                                                \
+        }                                                                    \
+    } while (0)
+
+/* Is SIZE the size of a type of element KIND that we can compare?  */
+static int
+itest_elem_size_ok(itest_elem_kind kind, size_t size)
+{
+    if (kind == ITEST_ELEM_FP) {
+        return size == sizeof(float) || size == sizeof(double);
+    }
+    return size == sizeof(unsigned char) || size == sizeof(unsigned short)
+           || size == sizeof(unsigned int)
+           || size == sizeof(unsigned long long);
+}
+
+/* Count the elements of GOT that differ from those of EXP (or from
+   EXP[0], if ALL is set).  Integers are equal if their bits are, and
+   floating-point numbers if they compare equal with ==.  */
+static size_t
+itest_elem_mismatches(itest_elem_kind kind, size_t size, const void *exp,
+                      int all, const void *got, size_t count)
+{
+    size_t n = 0;
+    if (kind == ITEST_ELEM_FP) {
+        if (size == sizeof(float)) {
+            ITEST_COUNT_MISMATCHES(float, exp, all, got, count, n);
+        } else {
+            ITEST_COUNT_MISMATCHES(double, exp, all, got, count, n);
+        }
+        return n;
+    }
+    if (!all && memcmp(exp, got, count * size) == 0) {
+        return 0;
+    }
+    if (size == sizeof(unsigned char)) {
+        ITEST_COUNT_MISMATCHES(unsigned char, exp, all, got, count, n);
+    } else if (size == sizeof(unsigned short)) {
+        ITEST_COUNT_MISMATCHES(unsigned short, exp, all, got, count, n);
+    } else if (size == sizeof(unsigned int)) {
+        ITEST_COUNT_MISMATCHES(unsigned int, exp, all, got, count, n);
+    } else {
+        ITEST_COUNT_MISMATCHES(unsigned long long, exp, all, got, count, n);
+    }
+    return n;
+}
+
+/* Where to print the details of a failed assertion: nowhere, during a
+   property trial, and into a temporary file for a test run on the
+   thread pool, so that they come out with its result.  */
+static FILE *
+itest_detail_out(void)
+{
+    itest_test_ctx *t = itest_cur ? itest_cur : itest_owner;
+    if (itest_quiet && itest_info.quiet_out != NULL) {
+        return itest_info.quiet_out;
+    }
+    if (t != NULL && t->buffer_detail) {
+        FILE *detail = ITEST_ATOMIC_LOAD(&t->detail);
+        if (detail == NULL) {
+            /* a helper thread of the test may be here too */
+            FILE *mine = tmpfile();
+            if (mine == NULL) {
+                return itest_info.out;
+            }
+            if (ITEST_ATOMIC_CAS(&t->detail, &detail, mine)) {
+                detail = mine;
+            } else {
+                fclose(mine);
+            }
+        }
+        return detail;
+    }
+    return itest_info.out;
+}
+
+/* Print the details of failed assertions buffered by test T, if PRINT
+   is set, and discard them.  */
+static void
+itest_flush_detail(itest_test_ctx *t, int print)
+{
+    char buf[BUFSIZ];
+    size_t n;
+    if (t->detail == NULL) {
+        return;
+    }
+    if (print) {
+        rewind(t->detail);
+        while ((n = fread(buf, 1, sizeof buf, t->detail)) > 0) {
+            fwrite(buf, 1, n, itest_info.out);
+        }
+    }
+    fclose(t->detail);
+    t->detail = NULL;
+}
+
+/* Print the element at P, of kind KIND and size SIZE, to OUT.  */
+static void
+itest_print_elem(FILE *out, itest_elem_kind kind, size_t size, const void *p)
+{
+    if (kind == ITEST_ELEM_FP) {
+        if (size == sizeof(float)) {
+            float v;
+            memcpy(&v, p, sizeof v);
+            fprintf(out, "%.9g", (double)v);
+        } else {
+            double v;
+            memcpy(&v, p, sizeof v);
+            fprintf(out, "%.17g", v);
+        }
+    } else if (kind == ITEST_ELEM_INT) {
+        long long v;
+        if (size == sizeof(signed char)) {
+            signed char c;
+            memcpy(&c, p, sizeof c);
+            v = c;
+        } else if (size == sizeof(short)) {
+            short s;
+            memcpy(&s, p, sizeof s);
+            v = s;
+        } else if (size == sizeof(int)) {
+            int i;
+            memcpy(&i, p, sizeof i);
+            v = i;
+        } else {
+            memcpy(&v, p, sizeof v);
+        }
+        fprintf(out, "%lld", v);
+    } else {
+        unsigned long long v;
+        if (size == sizeof(unsigned char)) {
+            unsigned char c;
+            memcpy(&c, p, sizeof c);
+            v = c;
+        } else if (size == sizeof(unsigned short)) {
+            unsigned short s;
+            memcpy(&s, p, sizeof s);
+            v = s;
+        } else if (size == sizeof(unsigned int)) {
+            unsigned int i;
+            memcpy(&i, p, sizeof i);
+            v = i;
+        } else {
+            memcpy(&v, p, sizeof v);
+        }
+        fprintf(out, "%llu", v);
+    }
+}
+
+/* Print the heading of a report of MISMATCHES differences between
+   arrays of COUNT elements.  */
+static void
+itest_report_mismatch_count(size_t mismatches, size_t count)
+{
+    fprintf(itest_detail_out(), "\n%lu of %lu element%s differ%s:\n",
+            (unsigned long)mismatches, (unsigned long)count,
+            count == 1 ? "" : "s", mismatches == 1 ? "s" : "");
+}
+
+/* Print the note ending a report of MISMATCHES differences, if not all
+   of them were listed.  */
+static void
+itest_report_mismatch_rest(size_t mismatches)
+{
+    if (mismatches > ITEST_ARRAY_MISMATCHES) {
+        fprintf(itest_detail_out(), "  ... and %lu more\n",
+                (unsigned long)(mismatches - ITEST_ARRAY_MISMATCHES));
+    }
+}
+
+/* Check that the COUNT elements of GOT are the same as those of EXP
+   (or all the same as EXP[0], if ALL is set), as one assertion.  If
+   not, report how many differ, and the first few, and fail.  */
+static void
+itest_check_elems(const char *msg, const char *file, unsigned int line,
+                  itest_elem_kind kind, size_t size, const void *exp,
+                  int all, const void *got, size_t count)
+{
+    const unsigned char *e = (const unsigned char *)exp;
+    const unsigned char *g = (const unsigned char *)got;
+    size_t mismatches, shown, i;
+    FILE *out;
+    ITEST_ATOMIC_INC(&itest_info.assertions);
+    itest_count_assert(file, line);
+    if (!itest_elem_size_ok(kind, size)) {
+        itest_fail("unsupported array element size", file, line);
+    }
+    mismatches = itest_elem_mismatches(kind, size, exp, all, got, count);
+    if (mismatches == 0) {
+        return;
+    }
+    out = itest_detail_out();
+    itest_report_mismatch_count(mismatches, count);
+    for (i = 0, shown = 0; i < count && shown < ITEST_ARRAY_MISMATCHES;
+         i++) {
+        const unsigned char *ei = all ? e : e + i * size;
+        if (itest_elem_mismatches(kind, size, ei, 1, g + i * size, 1)) {
+            fprintf(out, "  [%lu] expected ", (unsigned long)i);
+            itest_print_elem(out, kind, size, ei);
+            fprintf(out, ", got ");
+            itest_print_elem(out, kind, size, g + i * size);
+            fprintf(out, "\n");
+            shown++;
+        }
+    }
+    itest_report_mismatch_rest(mismatches);
+    itest_fail(msg, file, line);
+}
+
+/* The ULP-distance and relative-tolerance assertions work on the bit
+   patterns of floats and doubles.  */
+static_assert(sizeof(float) == sizeof(unsigned int), "unusual float size");
+static_assert(sizeof(double) == sizeof(unsigned long long),
+              "unusual double size");
+
+/* Ways of measuring the error of a floating-point result.  */
+typedef enum itest_fp_tol
+{
+    ITEST_FP_ULPS, /* distance in units in the last place */
+    ITEST_FP_REL   /* relative error */
+} itest_fp_tol;
+
+/* The distance between E and G in units in the last place: the number
+   of representable numbers between them, plus one.  +0 and -0 are the
+   same number.  A NaN is only equal to another NaN, and infinitely far
+   from anything else.  */
+static double
+itest_ulp_error_f(float e, float g)
+{
+    unsigned int ue, ug, sign = ~(~0u >> 1);
+    if (e != e || g != g) {
+        return (e != e && g != g) ? 0 : HUGE_VAL;
+    }
+    memcpy(&ue, &e, sizeof ue);
+    memcpy(&ug, &g, sizeof ug);
+    /* map to integers in the same order as the numbers */
+    ue = (ue & sign) ? sign - (ue & ~sign) : sign + ue;
+    ug = (ug & sign) ? sign - (ug & ~sign) : sign + ug;
+    return (double)(ue > ug ? ue - ug : ug - ue);
+}
+
+static double
+itest_ulp_error_d(double e, double g)
+{
+    unsigned long long ue, ug, sign = ~(~0ull >> 1);
+    if (e != e || g != g) {
+        return (e != e && g != g) ? 0 : HUGE_VAL;
+    }
+    memcpy(&ue, &e, sizeof ue);
+    memcpy(&ug, &g, sizeof ug);
+    ue = (ue & sign) ? sign - (ue & ~sign) : sign + ue;
+    ug = (ug & sign) ? sign - (ug & ~sign) : sign + ug;
+    return (double)(ue > ug ? ue - ug : ug - ue);
+}
+
+/* The error of G relative to E, or to G if that is larger in
+   magnitude, with NaN treated as for itest_ulp_error_d.  */
+static double
+itest_rel_error(double e, double g)
+{
+    double d, ae, ag, err;
+    if (e == g) {
+        return 0;
+    }
+    if (e != e || g != g) {
+        return (e != e && g != g) ? 0 : HUGE_VAL;
+    }
+    d   = e > g ? e - g : g - e;
+    ae  = e < 0 ? -e : e;
+    ag  = g < 0 ? -g : g;
+    err = d / (ae > ag ? ae : ag);
+    return err == err ? err : HUGE_VAL; /* inf / inf */
+}
+
+/* The error of element I of GOT, relative to element I of EXP.  */
+static double
+itest_fp_error(itest_fp_tol mode, size_t size, const void *exp,
+               const void *got, size_t i)
+{
+    if (size == sizeof(float)) {
+        float e, g;
+        memcpy(&e, (const unsigned char *)exp + i * size, sizeof e);
+        memcpy(&g, (const unsigned char *)got + i * size, sizeof g);
+        return mode == ITEST_FP_ULPS ? itest_ulp_error_f(e, g)
+                                     : itest_rel_error(e, g);
+    } else {
+        double e, g;
+        memcpy(&e, (const unsigned char *)exp + i * size, sizeof e);
+        memcpy(&g, (const unsigned char *)got + i * size, sizeof g);
+        return mode == ITEST_FP_ULPS ? itest_ulp_error_d(e, g)
+                                     : itest_rel_error(e, g);
+    }
+}
+
+/* Count the elements of GOT whose error, measured by ERR, relative to
+   the same element of EXP, exceeds TOL; also find the largest error.
+   One loop per element type and measure, so that the error function
+   can be inlined.  */
+#define ITEST_COUNT_FP_ERRORS(T, ERR, exp, got, count, tol, n, max)          \
+    do {                                                                     \
+        const T *e_ = (const T *)(exp);                                      \
+        const T *g_ = (const T *)(got);                                      \
+        size_t i_;                                                           \
+        for (i_ = 0; i_ < (count); i_++) {                                   \
+            double err_ = ERR(e_[i_], g_[i_]);                               \
+            (n) += err_ > (tol);                                             \
+            (max) = err_ > (max) ? err_ : (max);                             \
+        }                                                                    \
+    } while (0)
+
+/* Print a floating-point error or tolerance, measured as MODE, to
+   OUT.  */
+static void
+itest_print_fp_error(FILE *out, itest_fp_tol mode, double err)
+{
+    if (mode == ITEST_FP_ULPS) {
+        fprintf(out, "%.0f ulps", err);
+    } else {
+        fprintf(out, "%g relative", err);
+    }
+}
+
+/* Check that the COUNT elements of GOT, floats or doubles of size
+   SIZE, are within TOL of those of EXP, as one assertion.  If not,
+   report how many are not, the largest error, and the first few, and
+   fail.  */
+static void
+itest_check_fp_elems(const char *msg, const char *file, unsigned int line,
+                     itest_fp_tol mode, double tol, const void *exp,
+                     const void *got, size_t count, size_t size)
+{
+    size_t mismatches = 0, worst = 0, shown, i;
+    double max        = 0;
+    FILE *out;
+    ITEST_ATOMIC_INC(&itest_info.assertions);
+    itest_count_assert(file, line);
+    if (size != sizeof(float) && size != sizeof(double)) {
+        itest_fail("unsupported array element size", file, line);
+    }
+    if (size == sizeof(float) && mode == ITEST_FP_ULPS) {
+        ITEST_COUNT_FP_ERRORS(float, itest_ulp_error_f, exp, got, count, tol,
+                              mismatches, max);
+    } else if (size == sizeof(float)) {
+        ITEST_COUNT_FP_ERRORS(float, itest_rel_error, exp, got, count, tol,
+                              mismatches, max);
+    } else if (mode == ITEST_FP_ULPS) {
+        ITEST_COUNT_FP_ERRORS(double, itest_ulp_error_d, exp, got, count, tol,
+                              mismatches, max);
+    } else {
+        ITEST_COUNT_FP_ERRORS(double, itest_rel_error, exp, got, count, tol,
+                              mismatches, max);
+    }
+    if (mismatches == 0) {
+        return;
+    }
+    while (itest_fp_error(mode, size, exp, got, worst) < max) {
+        worst++;
+    }
+    out = itest_detail_out();
+    if (count == 1) {
+        fprintf(out, "\nExpected: ");
+        itest_print_elem(out, ITEST_ELEM_FP, size, exp);
+        fprintf(out, " +/- ");
+        itest_print_fp_error(out, mode, tol);
+        fprintf(out, "\n     Got: ");
+        itest_print_elem(out, ITEST_ELEM_FP, size, got);
+        fprintf(out, " (");
+        itest_print_fp_error(out, mode, max);
+        fprintf(out, ")\n");
+        itest_fail(msg, file, line);
+    }
+    fprintf(out, "\n%lu of %lu elements differ by more than ",
+            (unsigned long)mismatches, (unsigned long)count);
+    itest_print_fp_error(out, mode, tol);
+    fprintf(out, "; largest error ");
+    itest_print_fp_error(out, mode, max);
+    fprintf(out, " at [%lu]:\n", (unsigned long)worst);
+    for (i = 0, shown = 0; i < count && shown < ITEST_ARRAY_MISMATCHES;
+         i++) {
+        double err = itest_fp_error(mode, size, exp, got, i);
+        if (err > tol) {
+            fprintf(out, "  [%lu] expected ", (unsigned long)i);
+            itest_print_elem(out, ITEST_ELEM_FP, size,
+                             (const unsigned char *)exp + i * size);
+            fprintf(out, ", got ");
+            itest_print_elem(out, ITEST_ELEM_FP, size,
+                             (const unsigned char *)got + i * size);
+            fprintf(out, " (");
+            itest_print_fp_error(out, mode, err);
+            fprintf(out, ")\n");
+            shown++;
+        }
+    }
+    itest_report_mismatch_rest(mismatches);
+    itest_fail(msg, file, line);
+}
+
+/* Is FILTER a subset of NAME? */
+static int
+itest_name_match(const char *name, const char *filter, int res_if_none)
+{
+    size_t offset     = 0;
+    size_t filter_len = filter ? strlen(filter) : 0;
+    if (filter_len == 0) {
+        return res_if_none;
+    } /* no filter */
+    if (itest_info.exact_name_match && strlen(name) != filter_len) {
+        return 0; /* ignore substring matches */
+    }
+    while (name[offset] != '\0') {
+        if (name[offset] == filter[0]) {
+            if (0 == strncmp(&name[offset], filter, filter_len)) {
+                return 1;
+            }
+        }
+        offset++;
+    }
+
+    return 0;
+}
+
+/* The seed of the random streams of the test named NAME (or, if NULL,
+   the main thread's test): an FNV-1a hash of the name, mixed with the
+   run seed.  It depends on nothing else, so a test sees the same values
+   however the tests are ordered, shuffled, or spread over threads.  */
+static unsigned long long
+itest_name_seed(const char *name)
+{
+    unsigned long long h = 0xcbf29ce484222325ull;
+    const char *c;
+    for (c = itest_test_name(name); *c != '\0'; c++) {
+        h = (h ^ (unsigned char)*c) * 0x100000001b3ull;
+    }
+    return h ^ itest_info.seed * 0x9e3779b97f4a7c15ull;
+}
+
+/* Return the calling test's random stream.  The first call in each run
+   of a test seeds it from the test's name and the run seed.  A helper
+   thread shares its test's stream, so it should seed one of its own
+   from values drawn before it starts instead.  */
+itest_rand *
+itest_test_rand(void)
+{
+    itest_test_ctx *t = itest_cur     ? itest_cur
+                        : itest_owner ? itest_owner
+                                      : &itest_info.test;
+    if (!t->rand_ready) {
+        itest_rand_seed(&t->rand, itest_name_seed(t->name));
+        t->rand_ready = 1;
+        ITEST_ATOMIC_STORE(&itest_info.rand_used, 1u);
+    }
+    return &t->rand;
+}
+
+/* Set the run seed, from which every test's random streams are
+   seeded.  */
+void
+itest_set_seed(unsigned long long seed)
+{
+    itest_info.seed = seed;
+}
+
+/* Add the calling thread's inline assertions to the total.  Called
+   whenever a thread finishes a test, or a helper thread checks in.  */
+static void
+itest_flush_inline_assertions(void)
+{
+    if (itest_inline_assertions != 0) {
+        ITEST_ATOMIC_FETCH_ADD(&itest_info.assertions,
+                               (unsigned int)itest_inline_assertions);
+        itest_inline_assertions = 0;
+    }
+}
+
+/* If MSG is a formatted message, kept in FROM, copy it into BUF, which
+   lasts as long as the test it belongs to, and return the copy.
+   Otherwise return MSG.  */
+static const char *
+itest_keep_msg(const char *msg, const char *from, char *buf)
+{
+    if (msg == NULL || msg != from) {
+        return msg;
+    }
+    snprintf(buf, ITEST_MESSAGE_BUF_SIZE, "%s", msg);
+    return buf;
+}
+
+/* Return the test being run by the calling thread, to be passed to
+   itest_adopt_test by the helper threads it starts.  */
+void *
+itest_current_test(void)
+{
+    return itest_cur     ? itest_cur
+           : itest_owner ? itest_owner
+                         : &itest_info.test;
+}
+
+/* Make the calling helper thread part of TEST, as returned by
+   itest_current_test in the thread that started it.  Its assertions,
+   failures and skips then count towards that test.  */
+void
+itest_adopt_test(void *test)
+{
+    itest_owner = (itest_test_ctx *)test;
+}
+
+/* Return 1 if the calling thread is a helper thread of a running test:
+   not running one itself, but there is one running.  */
+static int
+itest_in_helper(void)
+{
+    return itest_cur == NULL
+           && (itest_owner != NULL || itest_info.running_test
+               || ITEST_ATOMIC_LOAD(&itest_info.pool_running));
+}
+
+/* Return the test the calling helper thread belongs to: the one it
+   adopted, or else the one running on the main thread.  A helper of a
+   test running on the thread pool can't be told apart from a helper of
+   any other, so if it hasn't adopted its test, the run is aborted.  */
+static itest_test_ctx *
+itest_owner_ctx(void)
+{
+    if (itest_owner != NULL) {
+        return itest_owner;
+    }
+    if (ITEST_ATOMIC_LOAD(&itest_info.pool_running)) {
+        fprintf(stderr, "Error: a helper thread of a parallel test must "
+                        "call itest_adopt_test before making "
+                        "assertions.\n");
+        abort();
+    }
+    return &itest_info.test;
+}
+
+/* Record the result of a test on behalf of a helper thread, then
+   terminate that thread.  The thread running the test picks up the
+   result at its next call to itest_check_threads.  */
+static ITEST_NORETURN
+itest_helper_thread_result(itest_test_res res, const char *msg,
+                           const char *file, unsigned int line)
+{
+    itest_test_ctx *t = itest_owner_ctx();
+    if (ITEST_ATOMIC_XCHG(&t->thread_claimed, 1u) == 0) {
+        t->thread_fail_file = file;
+        t->thread_fail_line = line;
+        t->thread_msg =
+            itest_keep_msg(msg, itest_fmt_buf, t->thread_msg_buf);
+        ITEST_ATOMIC_STORE(&t->thread_res, (unsigned int)res);
+    }
+    itest_flush_inline_assertions();
+#if ITEST_USE_PTHREADS
+    pthread_exit(NULL);
+#else
+    fprintf(stderr, "Error: cannot terminate helper thread.\n");
+    abort();
+#endif
+}
+
+/* Return the test being run by the calling thread.  In a helper
+   thread, record RES on the test's behalf and exit instead.  */
+static itest_test_ctx *
+itest_result_ctx(itest_test_res res, const char *msg, const char *file,
+                 unsigned int line)
+{
+    if (itest_in_helper()) {
+        itest_helper_thread_result(res, msg, file, line);
+    }
+    return itest_cur != NULL ? itest_cur : &itest_info.test;
+}
+
+ITEST_NORETURN
+itest_fail(const char *msg, const char *file, unsigned int line)
+{
+    itest_test_ctx *t;
+    if (itest_get_flag(ITEST_FLAG_ABORT_ON_FAIL)) {
+        abort();
+    }
+    t            = itest_result_ctx(ITEST_TEST_RES_FAIL, msg, file, line);
+    t->fail_file = file;
+    t->fail_line = line;
+    t->msg       = itest_keep_msg(msg, itest_fmt_buf, t->msg_buf);
+    longjmp(t->jump_dest, ITEST_TEST_RES_FAIL);
+}
+
+ITEST_NORETURN
+itest_failf(const char *file, unsigned int line, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(itest_fmt_buf, sizeof itest_fmt_buf, fmt, ap);
+    va_end(ap);
+    itest_fail(itest_fmt_buf, file, line);
+}
+
+ITEST_NORETURN
+itest_skip(const char *msg, const char *file, unsigned int line)
+{
+    itest_test_ctx *t;
+    t            = itest_result_ctx(ITEST_TEST_RES_SKIP, msg, file, line);
+    t->fail_file = file;
+    t->fail_line = line;
+    t->msg       = itest_keep_msg(msg, itest_fmt_buf, t->msg_buf);
+    longjmp(t->jump_dest, ITEST_TEST_RES_SKIP);
+}
+
+ITEST_NORETURN
+itest_skipf(const char *file, unsigned int line, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(itest_fmt_buf, sizeof itest_fmt_buf, fmt, ap);
+    va_end(ap);
+    itest_skip(itest_fmt_buf, file, line);
+}
+
+/* If a helper thread of the running test has failed or skipped, make
+ * the test fail or skip the same way.  Called from a helper thread, this
+ * instead terminates the caller, so that its siblings can stop early. */
+void
+itest_check_threads(void)
+{
+    itest_test_ctx *t;
+    unsigned int res;
+    itest_flush_inline_assertions();
+    if (itest_cur == NULL && !itest_in_helper()) {
+        return;
+    }
+    t   = itest_cur != NULL ? itest_cur : itest_owner_ctx();
+    res = ITEST_ATOMIC_LOAD(&t->thread_res);
+    if (res == ITEST_TEST_RES_PASS) {
+        return;
+    }
+    if (itest_cur == NULL) {
+        itest_helper_thread_result((itest_test_res)res, NULL, NULL, 0);
+    }
+    t->fail_file = t->thread_fail_file;
+    t->fail_line = t->thread_fail_line;
+    t->msg       = t->thread_msg;
+    longjmp(t->jump_dest, (int)res);
+}
+
+/* Run the current suite's setup hook, if it hasn't been run yet.  */
+static void
+itest_suite_setup(void)
+{
+    itest_suite_info *s = &itest_info.suite;
+    unsigned long long wall;
+    clock_t begin;
+    if (s->suite_state != 0) {
+        return;
+    }
+    s->suite_state = 1;
+    if (s->suite_setup == NULL) {
+        return;
+    }
+    wall  = itest_trace_now();
+    begin = itest_get_cpu_time();
+    s->suite_setup(s->suite_udata);
+    s->suite_setup_ticks = itest_ticks(begin, itest_get_cpu_time());
+    itest_trace_add(ITEST_TRACE_SETUP, "suite setup", wall, itest_trace_now(),
+                    0, 0);
+}
+
+/* Run the current suite's teardown hook, if its setup hook has run.  */
+static void
+itest_suite_teardown(void)
+{
+    itest_suite_info *s = &itest_info.suite;
+    unsigned long long wall;
+    clock_t begin;
+    if (s->suite_state != 1) {
+        return;
+    }
+    s->suite_state = 2;
+    if (s->suite_teardown == NULL) {
+        return;
+    }
+    wall  = itest_trace_now();
+    begin = itest_get_cpu_time();
+    s->suite_teardown(s->suite_udata);
+    s->suite_teardown_ticks = itest_ticks(begin, itest_get_cpu_time());
+    itest_trace_add(ITEST_TRACE_TEARDOWN, "suite teardown", wall,
+                    itest_trace_now(), 0, 0);
+}
+
+/* Check the name filtering and test shuffling state, if applicable.
+ * Returns 1 if the test named NAME should be run now.  Its full name is
+ * only worked out, by itest_test_name, if it is needed, which matters
+ * for long tables of cases run in random order.  */
+static int
+itest_test_select(const char *name)
+{
+    struct itest_run_info *g = &itest_info;
+    int match = 1;
+    g->test_name  = name;
+    g->name_ready = 0;
+    if (g->test_filter != NULL || g->test_exclude != NULL
+        || itest_get_flag(ITEST_FLAG_LIST_ONLY)) {
+        const char *full = itest_test_name(NULL);
+        match            = itest_name_match(full, g->test_filter, 1)
+                && !itest_name_match(full, g->test_exclude, 0);
+    }
+    if (itest_get_flag(ITEST_FLAG_LIST_ONLY)) { /* just listing test names */
+        if (match) {
+            fprintf(itest_info.out, "  %s\n", g->name_buf);
+        }
+        goto clear;
+    }
+    if (match
+        && (!itest_get_flag(ITEST_FLAG_FIRST_FAIL) || g->suite.failed == 0)) {
+        struct itest_prng *p = &g->prng[1];
+        if (p->random_order) {
+            p->count++;
+            if (!p->initialized || ((p->count - 1) != p->state)) {
+                goto clear; /* don't run this test yet */
+            }
+        }
+        if (g->running_test || itest_cur != NULL) {
+            fprintf(stderr, "Error: Test run inside another test.\n");
+            return 0;
+        }
+        p->count_run++;
+        itest_sites_alloc();
+        itest_suite_setup();
+        return 1; /* test should be run */
+    } else {
+        goto clear; /* skipped */
+    }
+clear:
+    g->name_suffix = NULL;
+    return 0;
+}
+
+/* Start running test T on the calling thread: call the setup hook, and
+   take the readings from before the test body.  */
+static void
+itest_test_begin(itest_test_ctx *t)
+{
+    struct itest_run_info *g = &itest_info;
+    t->pre_test      = itest_get_cpu_time();
+    t->wall_pre_test = itest_trace_now();
+    t->has_fixture   = g->setup != NULL || g->teardown != NULL;
+    t->worker        = 0;
+    t->msg           = NULL;
+    t->name          = NULL;
+    t->rand_ready    = 0;
+    itest_sites_reset(t);
+    if (g->setup) {
+        g->setup(g->setup_udata);
+    }
+    t->perf_valid    = (unsigned char)itest_perf_read(t->perf_pre);
+    t->usage_valid   = (unsigned char)itest_usage_read(t->usage_pre);
+    t->wall_pre_body = itest_trace_now();
+    t->pre_body      = itest_get_cpu_time();
+    itest_prof_start();
+    t->thread_claimed = 0;
+    t->thread_res     = ITEST_TEST_RES_PASS;
+    g->running_test   = 1;
+    itest_cur         = t;
+}
+
+/* Before running a test, check the name filtering and
+ * test shuffling state, if applicable, and then call setup hooks. */
+int
+itest_test_pre(const char *name)
+{
+    /* Tests queued to run in parallel go first.  */
+    itest_join_parallel();
+    if (!itest_test_select(name)) {
+        return 0;
+    }
+    itest_test_begin(&itest_info.test);
+    return 1;
+}
+
+static void
+itest_do_pass(const itest_test_ctx *t, const char *name)
+{
+    struct itest_run_info *g = &itest_info;
+    if (itest_get_verbosity()) {
+        fprintf(itest_info.out, "PASS %s: %s", itest_test_name(name),
+                t->msg ? t->msg : "");
+    } else {
+        fprintf(itest_info.out, ".");
+    }
+    g->suite.passed++;
+}
+
+static void
+itest_do_fail(const itest_test_ctx *t, const char *name)
+{
+    struct itest_run_info *g = &itest_info;
+    name                     = itest_test_name(name);
+    if (itest_get_verbosity()) {
+        fprintf(itest_info.out, "FAIL %s: %s (%s:%u)", name,
+                t->msg ? t->msg : "", t->fail_file, t->fail_line);
+    } else {
+        fprintf(itest_info.out, "F");
+        g->col++; /* add linebreak if in line of '.'s */
+        if (g->col != 0) {
+            fprintf(itest_info.out, "\n");
+            g->col = 0;
+        }
+        fprintf(itest_info.out, "FAIL %s: %s (%s:%u)\n", name,
+                t->msg ? t->msg : "", t->fail_file, t->fail_line);
+    }
+    g->suite.failed++;
+}
+
+static void
+itest_do_skip(const itest_test_ctx *t, const char *name)
+{
+    struct itest_run_info *g = &itest_info;
+    if (itest_get_verbosity()) {
+        fprintf(itest_info.out, "SKIP %s: %s", itest_test_name(name),
+                t->msg ? t->msg : "");
+    } else {
+        fprintf(itest_info.out, "s");
+    }
+    g->suite.skipped++;
+}
+
+/* Report the result RES of the test NAME (NULL for the main thread's
+   test), whose state is in T.  */
+static void
+itest_report_test(const itest_test_ctx *t, const char *name, int res)
+{
+    switch (res) {
+    case ITEST_TEST_RES_PASS:
+        itest_do_pass(t, name);
+        break;
+
+    case ITEST_TEST_RES_SKIP:
+        itest_do_skip(t, name);
+        break;
+
+    /* FIXME introduce a fail/error distinction.  */
+    case ITEST_TEST_RES_FAIL:
+    default:
+        itest_do_fail(t, name);
+        break;
+    }
+
+    itest_info.suite.tests_run++;
+    itest_info.col++;
+    itest_record_usage(t, name);
+    itest_trace_test(t, name, res);
+    if (t->has_fixture) {
+        itest_info.suite.fixture_tests++;
+        itest_info.suite.setup_ticks += itest_ticks(t->pre_test, t->pre_body);
+        itest_info.suite.body_ticks += itest_ticks(t->pre_body, t->post_body);
+        itest_info.suite.teardown_ticks +=
+            itest_ticks(t->post_body, t->post_test);
+    }
+    if (itest_get_verbosity()) {
+        itest_report_phases(t->pre_test, t->post_test, t->has_fixture,
+                            itest_ticks(t->pre_test, t->pre_body),
+                            itest_ticks(t->pre_body, t->post_body),
+                            itest_ticks(t->post_body, t->post_test));
+        itest_report_counters(t);
+        itest_report_usage(t);
+        fprintf(itest_info.out, "\n");
+        itest_report_sites(t);
+    } else if (itest_info.col % itest_info.width == 0) {
+        fprintf(itest_info.out, "\n");
+        itest_info.col = 0;
+    }
+    fflush(itest_info.out);
+}
+
+/* Finish running test T, begun by itest_test_begin: take the readings
+   from after the test body, and call the teardown hook.  */
+static void
+itest_test_end(itest_test_ctx *t)
+{
+    itest_prof_stop();
+    t->post_body      = itest_get_cpu_time();
+    t->wall_post_body = itest_trace_now();
+    if (t->perf_valid) {
+        t->perf_valid = (unsigned char)itest_perf_read(t->perf_post);
+    }
+    if (t->usage_valid) {
+        t->usage_valid = (unsigned char)itest_usage_read(t->usage_post);
+    }
+    if (itest_info.teardown) {
+        void *udata = itest_info.teardown_udata;
+        itest_info.teardown(udata);
+    }
+    t->post_test      = itest_get_cpu_time();
+    t->wall_post_test = itest_trace_now();
+    itest_flush_inline_assertions();
+    if (t->sites_valid) {
+        itest_sites_top(t->sites_top, 1);
+    }
+
+    itest_info.running_test = 0;
+    itest_cur               = NULL;
+}
+
+/* Report the result RES of the test run on the main thread, and
+   PROF_ERR, what itest_prof_save returned for it.  */
+static void
+itest_test_report(int res, int prof_err)
+{
+    itest_report_test(&itest_info.test, NULL, res);
+    itest_prof_note(NULL, prof_err);
+    itest_info.name_suffix = NULL;
+}
+
+void
+itest_test_post(int res)
+{
+    itest_test_end(&itest_info.test);
+    itest_test_report(res, itest_prof_save(NULL));
+}
+
+/* Queue a test to run on the thread pool, if it is parallel-safe and
+ * the pool is in use.  Returns 0 if the test should be run immediately
+ * instead. */
+static int
+itest_queue_test(int parallel, itest_test_cb *test_cb,
+                 itest_test_env_cb *test_env_cb, void *env,
+                 const char *test_name)
+{
+    struct itest_run_info *g = &itest_info;
+    itest_job *job;
+    if (!ITEST_PARALLEL || g->jobs <= 1 || !(parallel || g->suite.parallel)
+        || itest_cur != NULL) {
+        return 0;
+    }
+    if (g->queue_len == g->queue_size) {
+        size_t size = g->queue_size ? 2 * g->queue_size : 64;
+        itest_job *queue =
+            (itest_job *)realloc(g->queue, size * sizeof(itest_job));
+        if (queue == NULL) {
+            return 0; /* no room; run it now */
+        }
+        g->queue      = queue;
+        g->queue_size = size;
+    }
+    if (!itest_test_select(test_name)) {
+        return 1;
+    }
+    job = &g->queue[g->queue_len++];
+    memset(job, 0, sizeof *job);
+    job->test_cb        = test_cb;
+    job->test_env_cb    = test_env_cb;
+    job->env            = env;
+    job->setup          = g->setup;
+    job->setup_udata    = g->setup_udata;
+    job->teardown       = g->teardown;
+    job->teardown_udata = g->teardown_udata;
+    job->res            = -1;
+    memcpy(job->name, itest_test_name(NULL), sizeof job->name);
+    g->name_suffix = NULL;
+    return 1;
+}
+
+/* Run the body of the test on the main thread: TEST_CB, or ENV_CB with
+   ENV.  Returns its result.  */
+static int
+itest_run_body(itest_test_cb *test_cb, itest_test_env_cb *env_cb, void *env)
+{
+    /* ITEST_TEST_RES_PASS is 0, so the test is called only on setjmp's
+       first return */
+    int res = setjmp(itest_info.test.jump_dest);
+    if (res == ITEST_TEST_RES_PASS) {
+        if (test_cb != NULL) {
+            test_cb();
+        } else {
+            env_cb(env);
+        }
+        itest_check_threads();
+    }
+    return res;
+}
+
+#if ITEST_USE_FORK
+/* What a test run by itest_run_forked sends back from its process,
+   followed by the SITES call sites its assertions reached, with their
+   counts in test_count.  */
+typedef struct itest_fork_result
+{
+    int res;
+    unsigned int assertions;
+    unsigned long sites_lost;
+    size_t sites;
+
+    /* what itest_prof_save returned, and the sampling figures */
+    int prof_err;
+    unsigned int prof_count;
+    unsigned long long prof_ns;
+    unsigned long long prof_begin;
+    unsigned long long prof_end;
+
+    /* the test's state; pointers in it to string constants and to
+       itest_info are the same in both processes, but msg is sent
+       separately */
+    itest_test_ctx ctx;
+    unsigned char has_msg;
+    char msg[ITEST_MESSAGE_BUF_SIZE];
+} itest_fork_result;
+
+/* Write LEN bytes from BUF to FD.  Returns 1 if all were written.  */
+static int
+itest_fork_write(int fd, const void *buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = write(fd, (const char *)buf + got, len - got);
+        if (n <= 0 && errno != EINTR) {
+            return 0;
+        }
+        got += n > 0 ? (size_t)n : 0;
+    }
+    return 1;
+}
+
+/* Read LEN bytes from FD into BUF.  Returns 1 if all were read.  */
+static int
+itest_fork_read(int fd, void *buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, (char *)buf + got, len - got);
+        if (n == 0 || (n < 0 && errno != EINTR)) {
+            return 0;
+        }
+        got += n > 0 ? (size_t)n : 0;
+    }
+    return 1;
+}
+
+/* Run the test in a child process, forked from the state the suite's
+   setup hook left behind and discarded afterwards: its setup hook, the
+   body (TEST_CB, or ENV_CB with ENV) and its teardown hook all run
+   there, and so are measured there.  Its state is sent back to fill in
+   itest_info.test, and what itest_prof_save returned to PROF_ERR.  A
+   crash fails the test.  Returns its result.  */
+static int
+itest_run_forked(itest_test_cb *test_cb, itest_test_env_cb *env_cb,
+                 void *env, int *prof_err)
+{
+    struct itest_run_info *g = &itest_info;
+    itest_test_ctx *t        = &g->test;
+    itest_fork_result r;
+    int fds[2], status = 0, ok;
+    size_t i;
+    pid_t pid;
+
+    /* what the report shows if the child never sends its own */
+    t->pre_test      = itest_get_cpu_time();
+    t->pre_body      = t->pre_test;
+    t->wall_pre_test = itest_trace_now();
+    t->wall_pre_body = t->wall_pre_test;
+    t->has_fixture   = g->setup != NULL || g->teardown != NULL;
+    t->worker        = 0;
+    t->name          = NULL;
+    t->perf_valid    = 0;
+    t->usage_valid   = 0;
+    t->sites_valid   = 0;
+    if (itest_get_flag(ITEST_FLAG_PERF_COUNTERS)) {
+        itest_perf_open(); /* so the child knows which to reopen */
+    }
+
+    fflush(NULL); /* or the child would write out the same buffers */
+    if (pipe(fds) != 0) {
+        pid = -1;
+    } else if ((pid = fork()) < 0) {
+        int err = errno;
+        close(fds[0]);
+        close(fds[1]);
+        errno = err;
+    }
+    if (pid < 0) {
+        snprintf(t->msg_buf, sizeof t->msg_buf, "cannot fork: %s",
+                 strerror(errno));
+        t->msg       = t->msg_buf;
+        t->fail_file = __FILE__;
+        t->fail_line = __LINE__;
+        t->post_body = t->post_test = t->pre_test;
+        t->wall_post_body = t->wall_post_test = t->wall_pre_test;
+        return ITEST_TEST_RES_FAIL;
+    }
+
+    if (pid == 0) {
+        unsigned int before = g->assertions;
+        unsigned long lost  = g->sites_lost;
+        close(fds[0]);
+        memset(&r, 0, sizeof r);
+        itest_perf_reopen();
+        itest_test_begin(t);
+        r.res = itest_run_body(test_cb, env_cb, env);
+        itest_test_end(t);
+        r.prof_err   = itest_prof_save(NULL);
+        r.prof_count = g->prof_count;
+        r.prof_ns    = g->prof_ns;
+        r.prof_begin = g->prof_begin;
+        r.prof_end   = g->prof_end;
+        r.assertions = g->assertions - before;
+        r.sites_lost = g->sites_lost - lost;
+        r.ctx        = *t;
+        r.has_msg    = t->msg != NULL;
+        if (t->msg != NULL) {
+            snprintf(r.msg, sizeof r.msg, "%s", t->msg);
+        }
+        for (i = 0; g->sites != NULL && i < ITEST_ASSERT_SITES; i++) {
+            r.sites += g->sites[i].test_count != 0;
+        }
+        fflush(NULL);
+        ok = itest_fork_write(fds[1], &r, sizeof r);
+        for (i = 0; ok && r.sites != 0 && i < ITEST_ASSERT_SITES; i++) {
+            if (g->sites[i].test_count != 0) {
+                ok = itest_fork_write(fds[1], &g->sites[i],
+                                      sizeof g->sites[i]);
+            }
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    ok = itest_fork_read(fds[0], &r, sizeof r);
+    for (i = 0; ok && i < r.sites; i++) {
+        itest_assert_site site;
+        if (itest_fork_read(fds[0], &site, sizeof site)) {
+            itest_sites_add(site.file, site.line, site.test_count);
+        }
+    }
+    close(fds[0]);
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+
+    if (!ok) { /* it never finished */
+        if (WIFSIGNALED(status)) {
+            snprintf(t->msg_buf, sizeof t->msg_buf,
+                     "test process killed by signal %d", WTERMSIG(status));
+        } else {
+            snprintf(t->msg_buf, sizeof t->msg_buf,
+                     "test process exited with status %d",
+                     WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        }
+        t->msg            = t->msg_buf;
+        t->fail_file      = __FILE__;
+        t->fail_line      = __LINE__;
+        t->post_body      = itest_get_cpu_time();
+        t->post_test      = t->post_body;
+        t->wall_post_body = itest_trace_now();
+        t->wall_post_test = t->wall_post_body;
+        return ITEST_TEST_RES_FAIL;
+    }
+    ITEST_ATOMIC_FETCH_ADD(&g->assertions, r.assertions);
+    ITEST_ATOMIC_FETCH_ADD(&g->sites_lost, r.sites_lost);
+    *t     = r.ctx;
+    t->msg = NULL;
+    if (r.has_msg) {
+        memcpy(t->msg_buf, r.msg, sizeof t->msg_buf);
+        t->msg = t->msg_buf;
+    }
+    g->prof_count = r.prof_count;
+    g->prof_ns    = r.prof_ns;
+    g->prof_begin = r.prof_begin;
+    g->prof_end   = r.prof_end;
+    *prof_err     = r.prof_err;
+    return r.res;
+}
+#endif
+
+/* Run one test on the main thread: TEST_CB, or ENV_CB with ENV.  With
+   --fork, it runs in a process of its own.  */
+static void
+itest_run_main(itest_test_cb *test_cb, itest_test_env_cb *env_cb,
+               void *env, const char *test_name)
+{
+#if ITEST_USE_FORK
+    if (itest_get_flag(ITEST_FLAG_FORK)) {
+        /* Tests queued to run in parallel go first.  */
+        itest_join_parallel();
+        if (itest_test_select(test_name)) {
+            int prof_err = -1;
+            int res      = itest_run_forked(test_cb, env_cb, env, &prof_err);
+            itest_test_report(res, prof_err);
+        }
+        return;
+    }
+#endif
+    if (itest_test_pre(test_name) == 1) {
+        int res = itest_run_body(test_cb, env_cb, env);
+        itest_test_post((enum itest_test_res)res);
+    }
+}
+
 /* Run one test function, passing no arguments.  */
 void
-itest_run_test(itest_test_cb *test_cb, const char *test_name)
+itest_run_test(itest_test_cb *test_cb, const char *test_name)
+{
+    if (!itest_queue_test(0, test_cb, NULL, NULL, test_name)) {
+        itest_run_main(test_cb, NULL, NULL, test_name);
+    }
+}
+
+/* Run one test function, passing one `void *` argument.  */
+void
+itest_run_test_with_env(itest_test_env_cb *test_cb, const char *test_name,
+                        void *env)
+{
+    if (!itest_queue_test(0, NULL, test_cb, env, test_name)) {
+        itest_run_main(NULL, test_cb, env, test_name);
+    }
+}
+
+/* Run one parallel-safe test function, passing no arguments.  */
+void
+itest_run_test_parallel(itest_test_cb *test_cb, const char *test_name)
+{
+    if (!itest_queue_test(1, test_cb, NULL, NULL, test_name)) {
+        itest_run_test(test_cb, test_name);
+    }
+}
+
+/* Run one parallel-safe test function, passing one `void *` argument. */
+void
+itest_run_test_with_env_parallel(itest_test_env_cb *test_cb,
+                                 const char *test_name, void *env)
+{
+    if (!itest_queue_test(1, NULL, test_cb, env, test_name)) {
+        itest_run_test_with_env(test_cb, test_name, env);
+    }
+}
+
+/* Run TEST_CB once for each of the COUNT cases, of SIZE bytes each, in
+   CASES, on the thread pool if PARALLEL is set.  Cases are queued in
+   batches of ITEST_VECTORS_BATCH, so that a long table doesn't queue a
+   job, test context and all, for every one of them at once.  */
+static void
+itest_run_cases(int parallel, itest_test_env_cb *test_cb,
+                const char *test_name, const void *cases, size_t size,
+                size_t count, itest_case_name_cb *name_cb)
+{
+    struct itest_run_info *g = &itest_info;
+    size_t i;
+    g->case_name_cb = name_cb;
+    g->in_table     = 1;
+    for (i = 0; i < count; i++) {
+        void *env     = (void *)((const char *)cases + i * size);
+        g->case_ptr   = env;
+        g->case_index = i;
+        if (parallel) {
+            itest_run_test_with_env_parallel(test_cb, test_name, env);
+            if ((i + 1) % ITEST_VECTORS_BATCH == 0) {
+                g->in_table = 0;
+                itest_join_parallel();
+                g->in_table = 1;
+            }
+        } else {
+            itest_run_test_with_env(test_cb, test_name, env);
+        }
+    }
+    g->in_table = 0;
+}
+
+/* Run one test function per case of a table.  */
+void
+itest_run_table(itest_test_env_cb *test_cb, const char *test_name,
+                const void *cases, size_t size, size_t count,
+                itest_case_name_cb *name_cb)
+{
+    itest_run_cases(0, test_cb, test_name, cases, size, count, name_cb);
+}
+
+/* Run one parallel-safe test function per case of a table.  */
+void
+itest_run_table_parallel(itest_test_env_cb *test_cb, const char *test_name,
+                         const void *cases, size_t size, size_t count,
+                         itest_case_name_cb *name_cb)
+{
+    itest_run_cases(1, test_cb, test_name, cases, size, count, name_cb);
+}
+
+/* State of ITEST_RUN_COMBINATIONS: which interactions of STRENGTH axes
+   (one value of each) have been covered, and the combination being run.
+   The interactions of each set of STRENGTH axes are numbered from the
+   set's base, in mixed radix by the axes' values.  */
+typedef struct itest_cover
+{
+    const itest_axis *axes;
+    unsigned int naxes;
+    unsigned int strength;
+    size_t nsets;
+    unsigned int *sets;     /* the axes in each set, STRENGTH per set */
+    size_t *base;           /* nsets + 1 entries */
+    unsigned char *covered; /* one byte per interaction */
+    size_t uncovered;
+    size_t next;            /* no interaction before this is uncovered */
+    unsigned int *row;      /* index of each axis's value */
+    unsigned char *fixed;   /* axes already chosen in row */
+    char name[ITEST_TESTNAME_BUF_SIZE];
+} itest_cover;
+
+static void
+itest_cover_free(itest_cover *c)
+{
+    free(c->sets);
+    free(c->base);
+    free(c->covered);
+    free(c->row);
+    free(c->fixed);
+}
+
+/* Set up C to cover every interaction of STRENGTH of the NAXES axes,
+   which must all have values.  Returns 0 if out of memory.  */
+static int
+itest_cover_init(itest_cover *c, const itest_axis *axes, unsigned int naxes,
+                 unsigned int strength)
+{
+    size_t s, n = 1;
+    unsigned int k, j;
+
+    memset(c, 0, sizeof *c);
+    c->axes     = axes;
+    c->naxes    = naxes;
+    c->strength = strength;
+    for (k = 0; k < strength; k++) {
+        n = n * (naxes - k) / (k + 1);
+    }
+    c->nsets = n;
+    c->sets  = (unsigned int *)malloc(n * strength * sizeof *c->sets);
+    c->base  = (size_t *)malloc((n + 1) * sizeof *c->base);
+    c->row   = (unsigned int *)calloc(naxes, sizeof *c->row);
+    c->fixed = (unsigned char *)calloc(naxes, 1);
+    if (!c->sets || !c->base || !c->row || !c->fixed) {
+        return 0;
+    }
+
+    /* The sets of axes, in lexicographic order.  */
+    for (k = 0; k < strength; k++) {
+        c->sets[k] = k;
+    }
+    c->base[0] = 0;
+    for (s = 0; s < n; s++) {
+        unsigned int *set = &c->sets[s * strength];
+        size_t size       = 1;
+        for (k = 0; k < strength; k++) {
+            size *= axes[set[k]].count;
+        }
+        c->base[s + 1] = c->base[s] + size;
+        if (s + 1 < n) {
+            unsigned int *next = set + strength;
+            memcpy(next, set, strength * sizeof *set);
+            k = strength;
+            while (next[k - 1] == naxes - strength + k - 1) {
+                k--;
+            }
+            next[k - 1]++;
+            for (j = k; j < strength; j++) {
+                next[j] = next[j - 1] + 1;
+            }
+        }
+    }
+    c->uncovered = c->base[n];
+    c->covered   = (unsigned char *)calloc(c->uncovered, 1);
+    return c->covered != NULL;
+}
+
+/* Index of the interaction of set S in the current row.  */
+static size_t
+itest_cover_index(const itest_cover *c, size_t s)
+{
+    const unsigned int *set = &c->sets[s * c->strength];
+    size_t i                = 0;
+    unsigned int k;
+    for (k = 0; k < c->strength; k++) {
+        i = i * c->axes[set[k]].count + c->row[set[k]];
+    }
+    return c->base[s] + i;
+}
+
+/* Whether set S includes AXIS, and every one of its axes is fixed.  */
+static int
+itest_cover_ready(const itest_cover *c, size_t s, unsigned int axis)
+{
+    const unsigned int *set = &c->sets[s * c->strength];
+    unsigned int k;
+    int found = 0;
+    for (k = 0; k < c->strength; k++) {
+        if (!c->fixed[set[k]]) {
+            return 0;
+        }
+        found |= set[k] == axis;
+    }
+    return found;
+}
+
+/* Choose the next row: start from the first uncovered interaction, then
+   give each other axis, in turn, the value that covers the most new
+   interactions with the axes already chosen.  Ties go to the first
+   value counting from one that rotates with N, the number of rows so
+   far, to spread values out.  Returns 0 once everything is covered.  */
+static int
+itest_cover_next(itest_cover *c, size_t n)
+{
+    size_t s = 0, i;
+    unsigned int a, k;
+
+    if (c->uncovered == 0) {
+        return 0;
+    }
+    while (c->covered[c->next]) {
+        c->next++;
+    }
+    while (c->base[s + 1] <= c->next) {
+        s++;
+    }
+    memset(c->fixed, 0, c->naxes);
+    i = c->next - c->base[s];
+    for (k = c->strength; k-- > 0;) {
+        a           = c->sets[s * c->strength + k];
+        c->row[a]   = (unsigned int)(i % c->axes[a].count);
+        c->fixed[a] = 1;
+        i /= c->axes[a].count;
+    }
+
+    for (a = 0; a < c->naxes; a++) {
+        unsigned int count = c->axes[a].count, v, best = 0;
+        size_t best_gain = 0;
+        if (c->fixed[a]) {
+            continue;
+        }
+        c->fixed[a] = 1;
+        for (v = 0; v < count; v++) {
+            size_t gain = 0;
+            c->row[a]   = (unsigned int)((v + n) % count);
+            for (s = 0; s < c->nsets; s++) {
+                if (itest_cover_ready(c, s, a)
+                    && !c->covered[itest_cover_index(c, s)]) {
+                    gain++;
+                }
+            }
+            if (v == 0 || gain > best_gain) {
+                best      = c->row[a];
+                best_gain = gain;
+            }
+        }
+        c->row[a] = best;
+    }
+
+    for (s = 0; s < c->nsets; s++) {
+        i = itest_cover_index(c, s);
+        if (!c->covered[i]) {
+            c->covered[i] = 1;
+            c->uncovered--;
+        }
+    }
+    return 1;
+}
+
+/* Name the current row of the itest_cover TEST_CASE.  */
+static const char *
+itest_cover_name(const void *test_case)
+{
+    itest_cover *c = (itest_cover *)test_case;
+    size_t len     = 0;
+    unsigned int a;
+    c->name[0] = '\0';
+    for (a = 0; a < c->naxes && len < sizeof c->name; a++) {
+        const itest_axis *axis = &c->axes[a];
+        const char *sep        = a ? "," : "";
+        int n;
+        if (axis->values != NULL) {
+            n = snprintf(&c->name[len], sizeof c->name - len, "%s%s=%s", sep,
+                         axis->name, axis->values[c->row[a]]);
+        } else {
+            n = snprintf(&c->name[len], sizeof c->name - len, "%s%s=%u", sep,
+                         axis->name, c->row[a]);
+        }
+        if (n < 0) {
+            break;
+        }
+        len += (size_t)n;
+    }
+    return c->name;
+}
+
+/* Run one test function per combination of a covering array.  */
+void
+itest_run_combinations(itest_test_env_cb *test_cb, const char *test_name,
+                       const itest_axis *axes, unsigned int naxes,
+                       unsigned int strength)
+{
+    struct itest_run_info *g = &itest_info;
+    unsigned int *rows       = NULL;
+    itest_cover c;
+    double total = 1;
+    size_t n;
+    unsigned int a;
+
+    if (naxes == 0) {
+        return;
+    }
+    for (a = 0; a < naxes; a++) {
+        if (axes[a].count == 0) {
+            return; /* no combinations at all */
+        }
+        total *= axes[a].count;
+    }
+    if (strength > naxes) {
+        strength = naxes;
+    } else if (strength == 0) {
+        strength = 1;
+    }
+    /* In a parallel suite, rows are queued rather than run, so each
+       needs a copy of its own until the batch it is in has been run.  */
+    if (g->suite.parallel) {
+        rows = (unsigned int *)malloc((size_t)ITEST_VECTORS_BATCH * naxes
+                                      * sizeof *rows);
+    }
+    if (!itest_cover_init(&c, axes, naxes, strength)
+        || (g->suite.parallel && rows == NULL)) {
+        free(rows);
+        itest_cover_free(&c);
+        if (itest_test_pre(test_name) == 1) {
+            itest_info.test.msg       = "out of memory";
+            itest_info.test.fail_file = __FILE__;
+            itest_info.test.fail_line = __LINE__;
+            itest_test_post(ITEST_TEST_RES_FAIL);
+        }
+        return;
+    }
+
+    g->case_name_cb = itest_cover_name;
+    g->case_ptr     = &c;
+    g->in_table     = 1;
+    for (n = 0; itest_cover_next(&c, n); n++) {
+        if (rows != NULL) {
+            unsigned int *row = &rows[(n % ITEST_VECTORS_BATCH) * naxes];
+            memcpy(row, c.row, naxes * sizeof *row);
+            itest_run_test_with_env(test_cb, test_name, row);
+            if ((n + 1) % ITEST_VECTORS_BATCH == 0) {
+                g->in_table = 0;
+                itest_join_parallel();
+                g->in_table = 1;
+            }
+        } else {
+            itest_run_test_with_env(test_cb, test_name, c.row);
+        }
+    }
+    g->in_table = 0;
+    if (rows != NULL) {
+        itest_join_parallel();
+        free(rows);
+    }
+
+    if (itest_get_verbosity() && !itest_get_flag(ITEST_FLAG_LIST_ONLY)) {
+        fprintf(g->out,
+                "    %lu of %.0f combinations cover every %u-way "
+                "interaction of %u parameters\n",
+                (unsigned long)n, total, strength, naxes);
+    }
+    itest_cover_free(&c);
+}
+
+/* A file's contents, mapped into memory (or, without mmap, read).  */
+typedef struct itest_mapped_file
+{
+    const unsigned char *data;
+    size_t size;
+    void *base; /* what to unmap or free, if anything */
+} itest_mapped_file;
+
+/* Map the file at PATH into M, read-only.  Returns 0, with errno set,
+   on failure.  */
+static int
+itest_map_file(const char *path, itest_mapped_file *m)
+{
+#if ITEST_USE_MMAP
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    memset(m, 0, sizeof *m);
+    if (fd < 0) {
+        return 0;
+    }
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return 0;
+    }
+    m->size = (size_t)st.st_size;
+    m->data = (const unsigned char *)"";
+    if (m->size > 0) { /* mmap can't map nothing */
+        void *p = mmap(NULL, m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            errno = err;
+            return 0;
+        }
+        m->base = p;
+        m->data = (const unsigned char *)p;
+    }
+    close(fd);
+    return 1;
+#else
+    FILE *f = fopen(path, "rb");
+    unsigned char *buf = NULL;
+    size_t size = 0, cap = 0;
+    memset(m, 0, sizeof *m);
+    if (f == NULL) {
+        return 0;
+    }
+    for (;;) {
+        if (size == cap) {
+            unsigned char *p;
+            cap = cap ? 2 * cap : 4096;
+            p   = (unsigned char *)realloc(buf, cap);
+            if (p == NULL) {
+                free(buf);
+                fclose(f);
+                errno = ENOMEM;
+                return 0;
+            }
+            buf = p;
+        }
+        size += fread(buf + size, 1, cap - size, f);
+        if (size < cap) {
+            break;
+        }
+    }
+    fclose(f);
+    m->base = buf;
+    m->data = buf;
+    m->size = size;
+    return 1;
+#endif
+}
+
+static void
+itest_unmap_file(itest_mapped_file *m)
+{
+#if ITEST_USE_MMAP
+    if (m->base != NULL) {
+        munmap(m->base, m->size);
+    }
+#else
+    free(m->base);
+#endif
+    memset(m, 0, sizeof *m);
+}
+
+/* Run fuzz target TEST_CB, named TEST_NAME, on the SIZE bytes at DATA,
+ * outside of any test run.  A failure is printed and aborts the program.
+ * Returns 0, or -1 if the target skipped the input, which tells
+ * libFuzzer not to add it to the corpus.  */
+int
+itest_fuzz_one(itest_test_env_cb *test_cb, const char *test_name,
+               const unsigned char *data, size_t size)
+{
+    static itest_test_ctx ctx;
+    itest_fuzz_input input;
+    int res;
+    if (itest_info.out == NULL) {
+        itest_init();
+    }
+    /* nothing may carry over from the last input, such as a helper
+       thread's claim on reporting a result */
+    memset(&ctx, 0, sizeof ctx);
+    input.data = data;
+    input.size = size;
+    ctx.name   = test_name;
+    itest_cur  = &ctx;
+    res            = setjmp(ctx.jump_dest);
+    if (res == ITEST_TEST_RES_PASS) {
+        test_cb(&input);
+        itest_check_threads();
+    }
+    itest_cur = NULL;
+    if (res == ITEST_TEST_RES_FAIL) {
+        fflush(itest_info.out);
+        fprintf(stderr, "FAIL %s: %s (%s:%u)\n", test_name,
+                ctx.msg ? ctx.msg : "", ctx.fail_file, ctx.fail_line);
+        abort();
+    }
+    return res == ITEST_TEST_RES_SKIP ? -1 : 0;
+}
+
+/* A file of a corpus being replayed by ITEST_RUN_CORPUS.  Its contents
+   are only mapped while the test runs; if the test fails, they stay
+   mapped until its result has been reported.  */
+typedef struct itest_corpus_file
+{
+    itest_test_env_cb *test_cb;
+    char *path;
+    const char *name; /* within path */
+    itest_mapped_file map;
+} itest_corpus_file;
+
+/* itest_run_corpus's test function: run the real one on file ENV.  */
+static void
+itest_corpus_case(void *env)
+{
+    itest_corpus_file *f = (itest_corpus_file *)env;
+    itest_fuzz_input input;
+    if (!itest_map_file(f->path, &f->map)) {
+        itest_failf(__FILE__, __LINE__, "cannot read %s: %s", f->path,
+                    strerror(errno));
+    }
+    input.data = f->map.data;
+    input.size = f->map.size;
+    f->test_cb(&input);
+    itest_unmap_file(&f->map);
+}
+
+static const char *
+itest_corpus_name(const void *test_case)
+{
+    return ((const itest_corpus_file *)test_case)->name;
+}
+
+static int
+itest_corpus_cmp(const void *a, const void *b)
+{
+    return strcmp(((const itest_corpus_file *)a)->name,
+                  ((const itest_corpus_file *)b)->name);
+}
+
+/* List the regular files in DIR, sorted by name, into *FILES and
+   *COUNT.  Returns 0, with errno set, on failure.  */
+static int
+itest_corpus_list(const char *dir, itest_test_env_cb *test_cb,
+                  itest_corpus_file **files, size_t *count)
+{
+#if ITEST_USE_MMAP
+    DIR *d         = opendir(dir);
+    size_t dir_len = strlen(dir);
+    size_t cap     = 0;
+    struct dirent *e;
+    *files = NULL;
+    *count = 0;
+    if (d == NULL) {
+        return 0;
+    }
+    while ((e = readdir(d)) != NULL) {
+        struct stat st;
+        char *path;
+        if (e->d_name[0] == '.') {
+            continue;
+        }
+        path = (char *)malloc(dir_len + strlen(e->d_name) + 2);
+        if (path == NULL) {
+            break;
+        }
+        sprintf(path, "%s/%s", dir, e->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            free(path);
+            continue;
+        }
+        if (*count == cap) {
+            itest_corpus_file *p;
+            cap = cap ? 2 * cap : 64;
+            p   = (itest_corpus_file *)realloc(*files, cap * sizeof *p);
+            if (p == NULL) {
+                free(path);
+                break;
+            }
+            *files = p;
+        }
+        memset(&(*files)[*count], 0, sizeof **files);
+        (*files)[*count].test_cb = test_cb;
+        (*files)[*count].path    = path;
+        (*files)[*count].name    = path + dir_len + 1;
+        (*count)++;
+    }
+    closedir(d);
+    if (e != NULL) {
+        errno = ENOMEM;
+        return 0;
+    }
+    if (*count > 0) {
+        qsort(*files, *count, sizeof **files, itest_corpus_cmp);
+    }
+    return 1;
+#else
+    (void)dir;
+    (void)test_cb;
+    *files = NULL;
+    *count = 0;
+    errno  = ENOSYS;
+    return 0;
+#endif
+}
+
+/* Unmap FILES[FROM] to FILES[TO - 1], and free their paths.  */
+static void
+itest_corpus_release(itest_corpus_file *files, size_t from, size_t to)
+{
+    size_t i;
+    for (i = from; i < to; i++) {
+        itest_unmap_file(&files[i].map);
+        free(files[i].path);
+        files[i].path = NULL;
+    }
+}
+
+/* Run TEST_CB once for each file in directory DIR, on the thread pool
+   if PARALLEL is set.  Files are queued in batches of
+   ITEST_VECTORS_BATCH, and released once their batch is reported.  */
+static void
+itest_run_corpus_files(int parallel, itest_test_env_cb *test_cb,
+                       const char *test_name, const char *dir)
+{
+    struct itest_run_info *g = &itest_info;
+    itest_corpus_file *files;
+    size_t count, i, done = 0;
+
+    if (!itest_corpus_list(dir, test_cb, &files, &count)) {
+        int err = errno;
+        for (i = 0; i < count; i++) {
+            free(files[i].path);
+        }
+        free(files);
+        if (itest_test_pre(test_name) == 1) {
+            snprintf(g->test.msg_buf, sizeof g->test.msg_buf,
+                     "cannot read corpus %s: %s", dir, strerror(err));
+            g->test.msg       = g->test.msg_buf;
+            g->test.fail_file = __FILE__;
+            g->test.fail_line = __LINE__;
+            itest_test_post(ITEST_TEST_RES_FAIL);
+        }
+        return;
+    }
+
+    g->case_name_cb = itest_corpus_name;
+    for (i = 0; i < count; i++) {
+        g->case_ptr = &files[i];
+        g->in_table = 1;
+        if (parallel) {
+            itest_run_test_with_env_parallel(itest_corpus_case, test_name,
+                                             &files[i]);
+        } else {
+            itest_run_test_with_env(itest_corpus_case, test_name,
+                                    &files[i]);
+        }
+        g->in_table = 0;
+        if (!parallel || i + 1 - done == ITEST_VECTORS_BATCH) {
+            itest_join_parallel(); /* the queued tests use FILES */
+            itest_corpus_release(files, done, i + 1);
+            done = i + 1;
+        }
+    }
+
+    itest_join_parallel();
+    itest_corpus_release(files, done, count);
+    free(files);
+}
+
+/* Run one test function per file of a fuzzing corpus.  */
+void
+itest_run_corpus(itest_test_env_cb *test_cb, const char *test_name,
+                 const char *dir)
+{
+    itest_run_corpus_files(0, test_cb, test_name, dir);
+}
+
+/* Run one parallel-safe test function per file of a fuzzing corpus.  */
+void
+itest_run_corpus_parallel(itest_test_env_cb *test_cb, const char *test_name,
+                          const char *dir)
+{
+    itest_run_corpus_files(1, test_cb, test_name, dir);
+}
+
+/* A record of a test-vector file being run by itest_run_vectors.  */
+typedef struct itest_vector
+{
+    itest_test_env_cb *test_cb;
+    itest_record rec;
+    size_t claimed; /* the size its length prefix claims */
+} itest_vector;
+
+/* itest_run_vectors's test function: run the real one on record ENV.  */
+static void
+itest_vector_case(void *env)
+{
+    itest_vector *v = (itest_vector *)env;
+    if (v->claimed > v->rec.size) {
+        itest_failf(__FILE__, __LINE__,
+                    "record of %lu bytes, but only %lu are left in the file",
+                    (unsigned long)v->claimed, (unsigned long)v->rec.size);
+    }
+    v->test_cb(&v->rec);
+}
+
+/* Find the record at *POS in M, laid out as FORMAT, and set V to it and
+   *POS to the one after it.  Returns 0 if there are no more.  */
+static int
+itest_next_vector(const itest_mapped_file *m, size_t *pos,
+                  itest_vector_format format, itest_vector *v)
+{
+    const unsigned char *p = m->data + *pos;
+    size_t left            = m->size - *pos;
+    if (left == 0) {
+        return 0;
+    }
+    v->rec.offset = *pos;
+    if (format == ITEST_VECTORS_LEN32BE) {
+        size_t len = 4; /* a partial prefix is a record too short */
+        if (left >= 4) {
+            len = (size_t)p[0] << 24 | (size_t)p[1] << 16
+                  | (size_t)p[2] << 8 | (size_t)p[3];
+            p += 4;
+            left -= 4;
+            *pos += 4;
+        }
+        v->rec.data = p;
+        v->rec.size = len < left ? len : left;
+        v->claimed  = len;
+        *pos += v->rec.size;
+    } else {
+        const void *nl = memchr(p, '\n', left);
+        size_t len     = nl ? (size_t)((const unsigned char *)nl - p) : left;
+        v->rec.data = p;
+        v->rec.size = len;
+        v->claimed  = 0;
+        *pos += nl ? len + 1 : len;
+        if (len > 0 && p[len - 1] == '\r') {
+            v->rec.size--;
+        }
+    }
+    return 1;
+}
+
+/* Run TEST_CB once for each record in the test-vector file at PATH, on
+   the thread pool if PARALLEL is set.  Records are queued in batches of
+   ITEST_VECTORS_BATCH, so that a file of millions of them doesn't queue
+   millions of tests at once.  */
+static void
+itest_run_vector_file(int parallel, itest_test_env_cb *test_cb,
+                      const char *test_name, const char *path,
+                      itest_vector_format format)
+{
+    struct itest_run_info *g = &itest_info;
+    itest_mapped_file m;
+    itest_vector one, *batch = &one;
+    size_t pos = 0, n = 0, size = 1;
+
+    if (!itest_map_file(path, &m)) {
+        int err = errno;
+        if (itest_test_pre(test_name) == 1) {
+            snprintf(g->test.msg_buf, sizeof g->test.msg_buf,
+                     "cannot read test vectors %s: %s", path, strerror(err));
+            g->test.msg       = g->test.msg_buf;
+            g->test.fail_file = __FILE__;
+            g->test.fail_line = __LINE__;
+            itest_test_post(ITEST_TEST_RES_FAIL);
+        }
+        return;
+    }
+    if (parallel) {
+        batch = (itest_vector *)malloc(ITEST_VECTORS_BATCH * sizeof *batch);
+        if (batch != NULL) {
+            size = ITEST_VECTORS_BATCH;
+        } else {
+            batch    = &one; /* run them one at a time */
+            parallel = 0;
+        }
+    }
+
+    g->case_name_cb = NULL;
+    for (;;) {
+        itest_vector *v = &batch[n];
+        if (!itest_next_vector(&m, &pos, format, v)) {
+            break;
+        }
+        v->test_cb    = test_cb;
+        g->in_table   = 1;
+        g->case_index = v->rec.offset;
+        if (parallel) {
+            itest_run_test_with_env_parallel(itest_vector_case, test_name,
+                                             v);
+        } else {
+            itest_run_test_with_env(itest_vector_case, test_name, v);
+        }
+        g->in_table = 0;
+        if (++n == size) {
+            itest_join_parallel(); /* the queued tests use BATCH */
+            n = 0;
+        }
+    }
+
+    itest_join_parallel();
+    if (batch != &one) {
+        free(batch);
+    }
+    itest_unmap_file(&m);
+}
+
+/* Run one test function per record of a test-vector file.  */
+void
+itest_run_vectors(itest_test_env_cb *test_cb, const char *test_name,
+                  const char *path, itest_vector_format format)
+{
+    itest_run_vector_file(0, test_cb, test_name, path, format);
+}
+
+/* Run one parallel-safe test function per record of a test-vector
+   file.  */
+void
+itest_run_vectors_parallel(itest_test_env_cb *test_cb,
+                           const char *test_name, const char *path,
+                           itest_vector_format format)
+{
+    itest_run_vector_file(1, test_cb, test_name, path, format);
+}
+
+#if ITEST_PARALLEL
+
+/* Shared state of the workers running one batch of queued tests.  */
+typedef struct itest_pool
+{
+    itest_deque *deques;
+    unsigned int nworkers;
+} itest_pool;
+
+/* Worker-specific argument to itest_worker.  */
+typedef struct itest_worker_arg
+{
+    itest_pool *pool;
+    unsigned int index;
+    int started;
+    pthread_t thread;
+} itest_worker_arg;
+
+/* Take a job from the bottom of deque Q, which the caller owns.
+   Returns 0 if Q is empty.  */
+static int
+itest_deque_pop(itest_deque *q, size_t *item)
+{
+    long b = ITEST_ATOMIC_LOAD(&q->bottom) - 1;
+    long t;
+    int found = 1;
+    ITEST_ATOMIC_STORE(&q->bottom, b);
+    ITEST_ATOMIC_FENCE();
+    t = ITEST_ATOMIC_LOAD(&q->top);
+    if (t > b) {
+        ITEST_ATOMIC_STORE(&q->bottom, b + 1);
+        return 0;
+    }
+    *item = q->items[b];
+    if (t == b) {
+        /* last item; race any thieves for it */
+        found = ITEST_ATOMIC_CAS(&q->top, &t, t + 1);
+        ITEST_ATOMIC_STORE(&q->bottom, b + 1);
+    }
+    return found;
+}
+
+/* Steal a job from the top of deque Q.  Returns 0 if Q is empty, -1 if
+   another worker won the race for the top job.  */
+static int
+itest_deque_steal(itest_deque *q, size_t *item)
+{
+    long t = ITEST_ATOMIC_LOAD(&q->top);
+    long b;
+    ITEST_ATOMIC_FENCE();
+    b = ITEST_ATOMIC_LOAD(&q->bottom);
+    if (t >= b) {
+        return 0;
+    }
+    *item = q->items[t];
+    return ITEST_ATOMIC_CAS(&q->top, &t, t + 1) ? 1 : -1;
+}
+
+/* Run queued test number INDEX, on the calling worker thread.  */
+static void
+itest_run_job(size_t index, unsigned int worker)
+{
+    struct itest_run_info *g = &itest_info;
+    itest_job *job           = &g->queue[index];
+    itest_test_ctx *t        = &job->ctx;
+    int res;
+    if (itest_get_flag(ITEST_FLAG_FIRST_FAIL)
+        && ITEST_ATOMIC_LOAD(&g->pool_first_fail) < index) {
+        return; /* an earlier test failed; leave job->res at -1 */
+    }
+    t->pre_test      = itest_get_thread_cpu_time();
+    t->wall_pre_test = itest_trace_now();
+    t->has_fixture   = job->setup != NULL || job->teardown != NULL;
+    t->worker        = worker;
+    t->name          = job->name;
+    t->buffer_detail = 1;
+    if (job->setup) {
+        job->setup(job->setup_udata);
+    }
+    t->wall_pre_body = itest_trace_now();
+    t->pre_body      = itest_get_thread_cpu_time();
+    itest_cur        = t;
+    res       = setjmp(t->jump_dest);
+    if (res == ITEST_TEST_RES_PASS) {
+        if (job->test_cb) {
+            job->test_cb();
+        } else {
+            job->test_env_cb(job->env);
+        }
+        itest_check_threads();
+    }
+    t->post_body      = itest_get_thread_cpu_time();
+    t->wall_post_body = itest_trace_now();
+    if (job->teardown) {
+        job->teardown(job->teardown_udata);
+    }
+    t->post_test      = itest_get_thread_cpu_time();
+    t->wall_post_test = itest_trace_now();
+    itest_cur         = NULL;
+    itest_flush_inline_assertions();
+    job->res  = res;
+    if (res == ITEST_TEST_RES_FAIL) {
+        size_t first = ITEST_ATOMIC_LOAD(&g->pool_first_fail);
+        while (index < first
+               && !ITEST_ATOMIC_CAS(&g->pool_first_fail, &first, index)) {
+        }
+    }
+}
+
+/* Thread pool worker: run jobs from our own deque, then steal from the
+   others until there is nothing left anywhere.  */
+static void *
+itest_worker(void *varg)
+{
+    itest_worker_arg *arg = (itest_worker_arg *)varg;
+    itest_pool *pool      = arg->pool;
+    size_t item;
+    for (;;) {
+        unsigned int i;
+        int busy = 0;
+        while (itest_deque_pop(&pool->deques[arg->index], &item)) {
+            itest_run_job(item, arg->index);
+        }
+        for (i = 1; i < pool->nworkers; i++) {
+            itest_deque *victim =
+                &pool->deques[(arg->index + i) % pool->nworkers];
+            int got = itest_deque_steal(victim, &item);
+            if (got > 0) {
+                itest_run_job(item, arg->index);
+                busy = 1;
+                break;
+            }
+            busy |= got < 0;
+        }
+        if (!busy) {
+            return NULL;
+        }
+    }
+}
+
+/* Run every queued test on the thread pool.  */
+static void
+itest_run_queue(void)
+{
+    struct itest_run_info *g = &itest_info;
+    size_t n                 = g->queue_len;
+    unsigned int nworkers    = g->jobs < n ? g->jobs : (unsigned int)n;
+    size_t per_worker        = (n + nworkers - 1) / nworkers;
+    itest_pool pool;
+    itest_worker_arg *args;
+    size_t *items;
+    unsigned int i;
+
+    pool.nworkers = nworkers;
+    pool.deques   = (itest_deque *)calloc(nworkers, sizeof(itest_deque));
+    args  = (itest_worker_arg *)calloc(nworkers, sizeof(itest_worker_arg));
+    items = (size_t *)calloc(nworkers * per_worker, sizeof(size_t));
+    if (!pool.deques || !args || !items) {
+        size_t j;
+        for (j = 0; j < n; j++) {
+            itest_run_job(j, 0);
+        }
+        goto out;
+    }
+
+    /* Deal the jobs out round-robin, pushing each worker's share in
+       reverse so that each worker runs its own jobs in queue order.  */
+    for (i = 0; i < nworkers; i++) {
+        itest_deque *q = &pool.deques[i];
+        size_t j;
+        q->items = &items[i * per_worker];
+        for (j = i; j < n; j += nworkers) {
+            q->bottom++;
+        }
+        for (j = i; j < n; j += nworkers) {
+            q->items[q->bottom - 1 - (long)(j / nworkers)] = j;
+        }
+        args[i].pool  = &pool;
+        args[i].index = i;
+    }
+
+    /* The calling thread is worker 0.  If a thread can't be started,
+       the others will steal its jobs.  */
+    for (i = 1; i < nworkers; i++) {
+        args[i].started = 0
+                          == pthread_create(&args[i].thread, NULL,
+                                            itest_worker, &args[i]);
+    }
+    itest_worker(&args[0]);
+    for (i = 1; i < nworkers; i++) {
+        if (args[i].started) {
+            pthread_join(args[i].thread, NULL);
+        }
+    }
+
+out:
+    free(pool.deques);
+    free(args);
+    free(items);
+}
+
+#endif /* ITEST_PARALLEL */
+
+/* Run all queued parallel-safe tests, if any, and report their results
+ * in the order they were queued. */
+void
+itest_join_parallel(void)
+{
+#if ITEST_PARALLEL
+    struct itest_run_info *g = &itest_info;
+    size_t i;
+    if (g->queue_len == 0 || itest_cur != NULL) {
+        return;
+    }
+    g->pool_first_fail = (size_t)-1;
+    ITEST_ATOMIC_STORE(&g->pool_running, 1u);
+    itest_run_queue();
+    ITEST_ATOMIC_STORE(&g->pool_running, 0u);
+    /* With -f, tests after the first failure may also have run, but
+       are not reported, as if the tests had been run one by one.  */
+    for (i = 0; i < g->queue_len; i++) {
+        itest_job *job = &g->queue[i];
+        if (itest_get_flag(ITEST_FLAG_FIRST_FAIL) && i > g->pool_first_fail) {
+            itest_flush_detail(&job->ctx, 0);
+            continue;
+        }
+        if (job->res >= 0) {
+            itest_flush_detail(&job->ctx, 1);
+            itest_report_test(&job->ctx, job->name, job->res);
+        }
+    }
+    g->queue_len = 0;
+#endif
+}
+
+/* One thread of a test run by itest_run_concurrent.  */
+typedef struct itest_conc_thread
+{
+    itest_concurrent_env env;
+    struct itest_conc *conc;
+    itest_test_ctx ctx;
+    int res;
+    unsigned long long begin_ns;
+    unsigned long long end_ns;
+#if ITEST_USE_PTHREADS
+    int started;
+    pthread_t thread;
+#endif
+} itest_conc_thread;
+
+/* Shared state of a test run by itest_run_concurrent.  */
+typedef struct itest_conc
+{
+    itest_test_env_cb *test_cb;
+    unsigned long iterations;
+    unsigned int nthreads;
+    itest_conc_thread *threads;
+
+    /* set when any thread fails or skips; the first one to do so
+       claims the right to report the result */
+    unsigned int stop;
+    unsigned int claimed;
+    itest_conc_thread *first;
+
+#if ITEST_USE_PTHREADS
+    /* start barrier: every thread waits until all have arrived */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned int arrived;
+    unsigned int go;
+#endif
+} itest_conc;
+
+/* Run the test body ITERATIONS times on one thread, stopping early if
+   another thread fails.  */
+static void *
+itest_conc_thread_main(void *varg)
+{
+    itest_conc_thread *th = (itest_conc_thread *)varg;
+    itest_conc *c         = th->conc;
+    itest_test_ctx *t     = &th->ctx;
+    int res;
+
+#if ITEST_USE_PTHREADS
+    pthread_mutex_lock(&c->lock);
+    c->arrived++;
+    pthread_cond_broadcast(&c->cond);
+    while (!c->go) {
+        pthread_cond_wait(&c->cond, &c->lock);
+    }
+    pthread_mutex_unlock(&c->lock);
+#endif
+
+    itest_cur    = t;
+    th->begin_ns = itest_get_wall_time_ns();
+    res          = setjmp(t->jump_dest);
+    if (res == ITEST_TEST_RES_PASS) {
+        while (th->env.iteration < c->iterations
+               && !ITEST_ATOMIC_LOAD(&c->stop)) {
+            c->test_cb(&th->env);
+            th->env.iteration++;
+        }
+    }
+    th->end_ns = itest_get_wall_time_ns();
+    itest_cur  = NULL;
+    itest_flush_inline_assertions();
+    th->res    = res;
+    if (res != ITEST_TEST_RES_PASS) {
+        ITEST_ATOMIC_STORE(&c->stop, 1u);
+        if (ITEST_ATOMIC_XCHG(&c->claimed, 1u) == 0) {
+            c->first = th;
+        }
+    }
+    return NULL;
+}
+
+/* Run thread TH of C on the calling thread, which is running the test
+   itself: itest_conc_thread_main leaves itest_cur unset.  */
+static void
+itest_conc_run_here(itest_conc_thread *th)
+{
+    itest_test_ctx *saved = itest_cur;
+    itest_conc_thread_main(th);
+    itest_cur = saved;
+}
+
+/* Start every thread of C behind a barrier, and wait for them all.  */
+static void
+itest_conc_run(itest_conc *c)
+{
+    unsigned int i;
+#if ITEST_USE_PTHREADS
+    unsigned int started = 0;
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+    for (i = 0; i < c->nthreads; i++) {
+        itest_conc_thread *th = &c->threads[i];
+        th->started = 0
+                      == pthread_create(&th->thread, NULL,
+                                        itest_conc_thread_main, th);
+        started += (unsigned int)th->started;
+    }
+    pthread_mutex_lock(&c->lock);
+    while (c->arrived < started) {
+        pthread_cond_wait(&c->cond, &c->lock);
+    }
+    c->go = 1;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+    for (i = 0; i < c->nthreads; i++) {
+        itest_conc_thread *th = &c->threads[i];
+        if (th->started) {
+            pthread_join(th->thread, NULL);
+        } else {
+            c->go = 1;
+            itest_conc_run_here(th); /* couldn't start it */
+        }
+    }
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->lock);
+#else
+    for (i = 0; i < c->nthreads; i++) {
+        itest_conc_run_here(&c->threads[i]);
+    }
+#endif
+}
+
+/* Prepare C to run NTHREADS threads, each calling C->test_cb
+   C->iterations times.  C->threads must have room for them.  */
+static void
+itest_conc_reset(itest_conc *c, unsigned int nthreads)
+{
+    const itest_test_ctx *owner = itest_cur ? itest_cur : &itest_info.test;
+    unsigned long long seed     = itest_name_seed(owner->name);
+    unsigned int i;
+    memset(c->threads, 0, nthreads * sizeof(itest_conc_thread));
+    for (i = 0; i < nthreads; i++) {
+        c->threads[i].conc         = c;
+        c->threads[i].env.thread   = i;
+        c->threads[i].env.nthreads = nthreads;
+        /* each thread gets a stream of its own */
+        itest_rand_seed(&c->threads[i].ctx.rand, seed + i + 1);
+        c->threads[i].ctx.rand_ready = 1;
+    }
+    c->nthreads = nthreads;
+    c->stop     = 0;
+    c->claimed  = 0;
+    c->first    = NULL;
+#if ITEST_USE_PTHREADS
+    c->arrived = 0;
+    c->go      = 0;
+#endif
+}
+
+/* Allocate room in C for up to NTHREADS threads.  On failure, fail the
+   current test and return 0.  */
+static int
+itest_conc_init(itest_conc *c, itest_test_env_cb *test_cb,
+                unsigned int nthreads, unsigned long iterations)
+{
+    memset(c, 0, sizeof *c);
+    c->test_cb    = test_cb;
+    c->iterations = iterations;
+    c->threads =
+        (itest_conc_thread *)calloc(nthreads, sizeof(itest_conc_thread));
+    if (c->threads == NULL) {
+        itest_info.test.msg       = "out of memory";
+        itest_info.test.fail_file = __FILE__;
+        itest_info.test.fail_line = __LINE__;
+        itest_test_post(ITEST_TEST_RES_FAIL);
+        return 0;
+    }
+    return 1;
+}
+
+/* Run every thread of C.  If any of them failed or skipped, report
+   where, and longjmp out of the current test with its result.  */
+static void
+itest_conc_measure(itest_conc *c)
+{
+    itest_test_ctx *t = &itest_info.test;
+    itest_conc_run(c);
+    itest_check_threads(); /* helper threads of the test threads */
+    if (c->first != NULL) {
+        if (c->first->res == ITEST_TEST_RES_FAIL) {
+            fprintf(itest_info.out,
+                    "\nFailed in thread %u of %u, iteration %lu\n",
+                    c->first->env.thread, c->nthreads,
+                    c->first->env.iteration);
+        }
+        t->fail_file = c->first->ctx.fail_file;
+        t->fail_line = c->first->ctx.fail_line;
+        t->msg       = itest_keep_msg(c->first->ctx.msg,
+                                      c->first->ctx.msg_buf, t->msg_buf);
+        longjmp(t->jump_dest, c->first->res);
+    }
+}
+
+/* Aggregate throughput of all threads of C, in calls per second.  */
+static double
+itest_conc_rate(const itest_conc *c)
+{
+    unsigned long long begin = (unsigned long long)-1, end = 0;
+    unsigned long total      = 0;
+    unsigned int i;
+    for (i = 0; i < c->nthreads; i++) {
+        const itest_conc_thread *th = &c->threads[i];
+        total += th->env.iteration;
+        begin = th->begin_ns < begin ? th->begin_ns : begin;
+        end   = th->end_ns > end ? th->end_ns : end;
+    }
+    return end > begin ? (double)total * 1e9 / (double)(end - begin) : 0.0;
+}
+
+/* Print the throughput of each thread of C, and of all of them.  */
+static void
+itest_conc_report(const itest_conc *c)
+{
+    unsigned long total = 0;
+    unsigned int i;
+    for (i = 0; i < c->nthreads; i++) {
+        const itest_conc_thread *th = &c->threads[i];
+        double sec = (double)(th->end_ns - th->begin_ns) / 1e9;
+        fprintf(itest_info.out, "    thread %u: %lu ops, %.0f ops/sec\n", i,
+                th->env.iteration,
+                sec > 0 ? (double)th->env.iteration / sec : 0.0);
+        total += th->env.iteration;
+    }
+    fprintf(itest_info.out, "    total: %lu ops, %.0f ops/sec\n", total,
+            itest_conc_rate(c));
+}
+
+/* Run a test function on NTHREADS threads at once, each calling it
+ * ITERATIONS times.  The threads start together, after all of them
+ * have been created.  Reported as a single test.  */
+void
+itest_run_concurrent(itest_test_env_cb *test_cb, const char *test_name,
+                     unsigned int nthreads, unsigned long iterations)
 {
-    if (itest_test_pre(test_name) == 1) {
-        /* ITEST_TEST_RES_PASS is 0, so test_cb is called only on
-           setjmp's first return */
-        int res = setjmp(itest_info.jump_dest);
-        if (res == ITEST_TEST_RES_PASS) {
-            test_cb();
+    itest_conc c;
+    int res;
+    if (itest_test_pre(test_name) != 1) {
+        return;
+    }
+    if (!itest_conc_init(&c, test_cb, nthreads, iterations)) {
+        return;
+    }
+    itest_conc_reset(&c, nthreads);
+
+    res = setjmp(itest_info.test.jump_dest);
+    if (res == ITEST_TEST_RES_PASS) {
+        itest_conc_measure(&c);
+    }
+    itest_test_post(res);
+    if (itest_get_verbosity() && itest_get_flag(ITEST_FLAG_RECORD_TIMING)) {
+        itest_conc_report(&c);
+    }
+    free(c.threads);
+}
+
+/* Fill in the defaults for anything RUN leaves unspecified, using
+   DEFAULTS for the thread counts if need be.  Return the largest thread
+   count.  */
+static unsigned int
+itest_scaling_defaults(itest_scaling_spec *run, unsigned int *defaults)
+{
+    unsigned int max = 0;
+    size_t i;
+    if (run->threads == NULL || run->nthreads == 0) {
+        /* 1, 2, 4, ... up to and including the number of CPUs */
+        unsigned int ncpu = itest_cpu_count(), n;
+        run->nthreads     = 0;
+        for (n = 1; n < ncpu && n <= UINT_MAX / 2; n *= 2) {
+            defaults[run->nthreads++] = n;
         }
-        itest_test_post((enum itest_test_res)res);
+        defaults[run->nthreads++] = ncpu;
+        run->threads              = defaults;
     }
+    for (i = 0; i < run->nthreads; i++) {
+        max = run->threads[i] > max ? run->threads[i] : max;
+    }
+    if (run->check_at == 0) {
+        run->check_at = max;
+    }
+    return max;
 }
 
-/* Run one test function, passing one `void *` argument.  */
+/* Fail the current test with message MSG, at FILE:LINE.  */
+static ITEST_NORETURN
+itest_scaling_fail(const char *msg, const char *file, unsigned int line)
+{
+    itest_info.test.msg       = msg;
+    itest_info.test.fail_file = file;
+    itest_info.test.fail_line = line;
+    longjmp(itest_info.test.jump_dest, ITEST_TEST_RES_FAIL);
+}
+
+/* Measure the throughput of C at each thread count in RUN, storing it
+   in RATES, and check the efficiency requirement if any.  A requirement
+   that can't be checked fails the test rather than passing it.  */
+static void
+itest_scaling_measure(itest_conc *c, const itest_scaling_spec *run,
+                      double *rates, const char *file, unsigned int line)
+{
+    size_t i, at = run->nthreads;
+    double eff;
+    for (i = 0; i < run->nthreads; i++) {
+        if (run->threads[i] == run->check_at) {
+            at = i;
+            break;
+        }
+    }
+    if (run->min_efficiency > 0 && at == run->nthreads) {
+        fprintf(itest_info.out,
+                "\nNo run at %u thread%s to check efficiency at\n",
+                run->check_at, run->check_at == 1 ? "" : "s");
+        itest_scaling_fail("efficiency can't be checked", file, line);
+    }
+    for (i = 0; i < run->nthreads; i++) {
+        itest_conc_reset(c, run->threads[i]);
+        itest_conc_measure(c);
+        rates[i] = itest_conc_rate(c);
+    }
+    if (run->min_efficiency <= 0) {
+        return;
+    }
+    if (rates[0] <= 0) {
+        fprintf(itest_info.out, "\nNo throughput at %u thread%s\n",
+                run->threads[0], run->threads[0] == 1 ? "" : "s");
+        itest_scaling_fail("efficiency can't be checked", file, line);
+    }
+    eff = rates[at] / rates[0] * run->threads[0] / run->threads[at];
+    if (eff < run->min_efficiency) {
+        fprintf(itest_info.out,
+                "\nEfficiency at %u thread%s: %.2f, "
+                "expected at least %.2f\n",
+                run->threads[at], run->threads[at] == 1 ? "" : "s", eff,
+                run->min_efficiency);
+        itest_scaling_fail("parallel efficiency too low", file, line);
+    }
+}
+
+/* Run a test function as ITEST_RUN_CONCURRENT does, once for each
+ * thread count in SPEC, and work out how well its throughput scales.
+ * The first thread count is the baseline: speedup is throughput
+ * relative to it, and efficiency is speedup per added thread.  If SPEC
+ * sets a minimum efficiency, the test fails when efficiency at the
+ * chosen thread count falls short.  Reported as a single test.  */
 void
-itest_run_test_with_env(itest_test_env_cb *test_cb, const char *test_name,
-                        void *env)
+itest_run_scaling(itest_test_env_cb *test_cb, const char *test_name,
+                  const itest_scaling_spec *spec, const char *file,
+                  unsigned int line)
 {
-    if (itest_test_pre(test_name) == 1) {
-        /* ITEST_TEST_RES_PASS is 0, so test_cb is called only on
-           setjmp's first return */
-        int res = setjmp(itest_info.jump_dest);
-        if (res == ITEST_TEST_RES_PASS) {
-            test_cb(env);
+    unsigned int defaults[sizeof(unsigned int) * CHAR_BIT + 1];
+    itest_scaling_spec run = *spec;
+    unsigned int max       = itest_scaling_defaults(&run, defaults);
+    double *rates;
+    itest_conc c;
+    size_t i;
+    int res;
+
+    if (itest_test_pre(test_name) != 1) {
+        return;
+    }
+    rates = (double *)calloc(run.nthreads, sizeof(double));
+    if (rates == NULL) {
+        itest_info.test.msg       = "out of memory";
+        itest_info.test.fail_file = __FILE__;
+        itest_info.test.fail_line = __LINE__;
+        itest_test_post(ITEST_TEST_RES_FAIL);
+        return;
+    }
+    if (!itest_conc_init(&c, test_cb, max, run.iterations)) {
+        free(rates);
+        return;
+    }
+
+    res = setjmp(itest_info.test.jump_dest);
+    if (res == ITEST_TEST_RES_PASS) {
+        itest_scaling_measure(&c, &run, rates, file, line);
+    }
+    itest_test_post(res);
+    /* The last rate is only set once every thread count has run.  */
+    if (rates[run.nthreads - 1] > 0 && itest_get_verbosity()
+        && itest_get_flag(ITEST_FLAG_RECORD_TIMING)) {
+        for (i = 0; i < run.nthreads; i++) {
+            double speedup = rates[0] > 0 ? rates[i] / rates[0] : 0.0;
+            fprintf(itest_info.out,
+                    "    %u thread%s: %.0f ops/sec, speedup %.2f, "
+                    "efficiency %.2f\n",
+                    run.threads[i], run.threads[i] == 1 ? "" : "s", rates[i],
+                    speedup,
+                    speedup * run.threads[0] / run.threads[i]);
         }
-        itest_test_post((enum itest_test_res)res);
     }
+    free(c.threads);
+    free(rates);
 }
 
-ITEST_NORETURN
-itest_fail(const char *msg, const char *file, unsigned int line)
+/* Latency histograms are log-linear, like HdrHistogram's: values below
+ * 2**ITEST_HIST_BITS nanoseconds each get a bucket of their own, and
+ * each power of two above that is split into 2**ITEST_HIST_BITS equal
+ * buckets, so every bucket is within 1/2**ITEST_HIST_BITS of the values
+ * it counts.  */
+#define ITEST_HIST_BITS    5
+#define ITEST_HIST_SUB     (1u << ITEST_HIST_BITS)
+#define ITEST_HIST_BUCKETS ((64 - ITEST_HIST_BITS + 1) * ITEST_HIST_SUB)
+
+static size_t
+itest_hist_index(unsigned long long ns)
 {
-    itest_info.fail_file = file;
-    itest_info.fail_line = line;
-    itest_info.msg       = msg;
-    if (itest_get_flag(ITEST_FLAG_ABORT_ON_FAIL)) {
-        abort();
+    unsigned int shift = 0;
+    if (ns < ITEST_HIST_SUB) {
+        return (size_t)ns;
     }
-    longjmp(itest_info.jump_dest, ITEST_TEST_RES_FAIL);
+    while ((ns >> shift) >= 2 * ITEST_HIST_SUB) {
+        shift++;
+    }
+    return (size_t)(shift + 1) * ITEST_HIST_SUB
+           + (size_t)((ns >> shift) - ITEST_HIST_SUB);
 }
 
-ITEST_NORETURN
-itest_skip(const char *msg, const char *file, unsigned int line)
+/* Largest value counted by bucket INDEX.  */
+static unsigned long long
+itest_hist_value(size_t index)
 {
-    itest_info.fail_file = file;
-    itest_info.fail_line = line;
-    itest_info.msg       = msg;
-    longjmp(itest_info.jump_dest, ITEST_TEST_RES_SKIP);
+    unsigned int shift;
+    if (index < ITEST_HIST_SUB) {
+        return index;
+    }
+    shift = (unsigned int)(index / ITEST_HIST_SUB - 1);
+    return ((ITEST_HIST_SUB + index % ITEST_HIST_SUB + 1ull) << shift) - 1;
 }
 
-/* Before running a test, check the name filtering and
- * test shuffling state, if applicable, and then call setup hooks. */
-int
-itest_test_pre(const char *name)
+/* A completed latency measurement.  */
+typedef struct itest_latency
 {
-    struct itest_run_info *g = &itest_info;
-    int match;
-    itest_buffer_test_name(name);
-    match = itest_name_match(g->name_buf, g->test_filter, 1)
-            && !itest_name_match(g->name_buf, g->test_exclude, 0);
-    if (itest_get_flag(ITEST_FLAG_LIST_ONLY)) { /* just listing test names */
-        if (match) {
-            fprintf(itest_info.out, "  %s\n", g->name_buf);
+    unsigned long *buckets;
+    unsigned long count;
+    unsigned long long max;
+} itest_latency;
+
+/* The smallest value that at least FRACTION of the samples in L do not
+   exceed, to within the precision of the histogram.  */
+static unsigned long long
+itest_latency_percentile(const itest_latency *l, double fraction)
+{
+    unsigned long want = (unsigned long)(fraction * (double)l->count);
+    unsigned long seen = 0;
+    size_t i;
+    if ((double)want < fraction * (double)l->count) {
+        want++; /* round up */
+    }
+    for (i = 0; i < ITEST_HIST_BUCKETS; i++) {
+        seen += l->buckets[i];
+        if (seen >= want && seen > 0) {
+            unsigned long long v = itest_hist_value(i);
+            return v < l->max ? v : l->max;
         }
-        goto clear;
     }
-    if (match
-        && (!itest_get_flag(ITEST_FLAG_FIRST_FAIL) || g->suite.failed == 0)) {
-        struct itest_prng *p = &g->prng[1];
-        if (p->random_order) {
-            p->count++;
-            if (!p->initialized || ((p->count - 1) != p->state)) {
-                goto clear; /* don't run this test yet */
+    return l->max;
+}
+
+/* Write the histogram of L to PATH, one line per nonempty bucket: the
+   largest latency it counts, its count, and the cumulative fraction of
+   samples up to and including it.  */
+static int
+itest_latency_dump(const itest_latency *l, const char *path)
+{
+    unsigned long seen = 0;
+    size_t i;
+    int ok;
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        return 0;
+    }
+    fprintf(fp, "# latency_ns\tcount\tpercentile\n");
+    for (i = 0; i < ITEST_HIST_BUCKETS; i++) {
+        if (l->buckets[i] != 0) {
+            unsigned long long v = itest_hist_value(i);
+            seen += l->buckets[i];
+            fprintf(fp, "%llu\t%lu\t%.6f\n", v < l->max ? v : l->max,
+                    l->buckets[i], (double)seen / (double)l->count);
+        }
+    }
+    ok = !ferror(fp);
+    return fclose(fp) == 0 && ok;
+}
+
+/* Percentiles reported by, and checked by, itest_run_latency, in the
+   same order as their limits in itest_latency_spec.  */
+static const struct itest_latency_point
+{
+    const char *name;
+    double fraction;
+} itest_latency_points[] = {
+    { "p50", 0.5 },     { "p90", 0.9 }, { "p99", 0.99 },
+    { "p99.9", 0.999 }, { "max", 1.0 },
+};
+
+#define ITEST_LATENCY_POINTS                                                 \
+    (sizeof itest_latency_points / sizeof itest_latency_points[0])
+
+/* Call TEST_CB SPEC->iterations times, timing every call or every
+   SPEC->sample_every'th call into L, then check the limits in SPEC.  */
+static void
+itest_latency_measure(itest_test_env_cb *test_cb,
+                      const itest_latency_spec *spec, itest_latency *l,
+                      const char *file, unsigned int line)
+{
+    unsigned long every = spec->sample_every ? spec->sample_every : 1;
+    const unsigned long long limits[ITEST_LATENCY_POINTS] = {
+        spec->max_p50, spec->max_p90, spec->max_p99, spec->max_p999,
+        spec->max_max,
+    };
+    itest_concurrent_env env;
+    size_t i;
+    memset(&env, 0, sizeof env);
+    env.nthreads = 1;
+    for (; env.iteration < spec->iterations; env.iteration++) {
+        if (env.iteration % every == 0) {
+            unsigned long long start = itest_get_wall_time_ns(), ns;
+            test_cb(&env);
+            ns = itest_get_wall_time_ns() - start;
+            l->buckets[itest_hist_index(ns)]++;
+            l->count++;
+            l->max = ns > l->max ? ns : l->max;
+        } else {
+            test_cb(&env);
+        }
+    }
+
+    if (spec->dump_file != NULL && !itest_latency_dump(l, spec->dump_file)) {
+        fprintf(itest_info.out, "\n%s: %s\n", spec->dump_file,
+                strerror(errno));
+        itest_info.test.msg       = "could not write latency histogram";
+        itest_info.test.fail_file = file;
+        itest_info.test.fail_line = line;
+        longjmp(itest_info.test.jump_dest, ITEST_TEST_RES_FAIL);
+    }
+    for (i = 0; i < ITEST_LATENCY_POINTS; i++) {
+        const struct itest_latency_point *pt = &itest_latency_points[i];
+        unsigned long long v;
+        if (limits[i] == 0) {
+            continue;
+        }
+        v = itest_latency_percentile(l, pt->fraction);
+        if (v > limits[i]) {
+            fprintf(itest_info.out,
+                    "\n%s latency: %llu ns, expected at most %llu ns\n",
+                    pt->name, v, limits[i]);
+            itest_info.test.msg       = "latency too high";
+            itest_info.test.fail_file = file;
+            itest_info.test.fail_line = line;
+            longjmp(itest_info.test.jump_dest, ITEST_TEST_RES_FAIL);
+        }
+    }
+}
+
+/* Run a test function repeatedly as a latency benchmark, recording the
+ * wall-clock time of each call (or of a sample of calls) in a
+ * histogram.  In verbose mode, report percentiles of the distribution;
+ * fail if any of them exceeds its limit in SPEC.  Reported as a single
+ * test.  */
+void
+itest_run_latency(itest_test_env_cb *test_cb, const char *test_name,
+                  const itest_latency_spec *spec, const char *file,
+                  unsigned int line)
+{
+    itest_latency l;
+    size_t i;
+    int res;
+
+    if (itest_test_pre(test_name) != 1) {
+        return;
+    }
+    memset(&l, 0, sizeof l);
+    l.buckets =
+        (unsigned long *)calloc(ITEST_HIST_BUCKETS, sizeof(unsigned long));
+    if (l.buckets == NULL) {
+        itest_info.test.msg       = "out of memory";
+        itest_info.test.fail_file = __FILE__;
+        itest_info.test.fail_line = __LINE__;
+        itest_test_post(ITEST_TEST_RES_FAIL);
+        return;
+    }
+
+    res = setjmp(itest_info.test.jump_dest);
+    if (res == ITEST_TEST_RES_PASS) {
+        itest_latency_measure(test_cb, spec, &l, file, line);
+    }
+    itest_test_post(res);
+    if (l.count > 0 && itest_get_verbosity()
+        && itest_get_flag(ITEST_FLAG_RECORD_TIMING)) {
+        fprintf(itest_info.out, "    latency (%lu samples):", l.count);
+        for (i = 0; i < ITEST_LATENCY_POINTS; i++) {
+            const struct itest_latency_point *pt = &itest_latency_points[i];
+            fprintf(itest_info.out, "%s %s %llu ns", i > 0 ? "," : "",
+                    pt->name, itest_latency_percentile(&l, pt->fraction));
+        }
+        fprintf(itest_info.out, "\n");
+    }
+    free(l.buckets);
+}
+
+/* Call TEST_CB ITERATIONS times.  Under Callgrind, count only these
+   calls, and dump the counts labelled with the test name: the name is
+   built, and the clock read, outside the counted region.  */
+static void
+itest_bench_measure(itest_test_env_cb *test_cb, unsigned long iterations,
+                    unsigned long long *ns)
+{
+    itest_concurrent_env env;
+    unsigned long long start;
+#if ITEST_USE_VALGRIND
+    const char *name = itest_test_name(NULL);
+#endif
+    memset(&env, 0, sizeof env);
+    env.nthreads = 1;
+    start        = itest_get_wall_time_ns();
+#if ITEST_USE_VALGRIND
+    CALLGRIND_ZERO_STATS;
+#endif
+    for (; env.iteration < iterations; env.iteration++) {
+        test_cb(&env);
+    }
+#if ITEST_USE_VALGRIND
+    CALLGRIND_DUMP_STATS_AT(name);
+#endif
+    *ns = itest_get_wall_time_ns() - start;
+}
+
+/* Run itest_bench_measure as the body of the test, storing the time
+   taken in *NS.  Returns the test's result.  */
+static int
+itest_bench_run(itest_test_env_cb *test_cb, unsigned long iterations,
+                unsigned long long *ns)
+{
+    int res = setjmp(itest_info.test.jump_dest);
+    if (res == ITEST_TEST_RES_PASS) {
+        itest_bench_measure(test_cb, iterations, ns);
+    }
+    return res;
+}
+
+/* Run a test function ITERATIONS times as a benchmark.  Under
+ * Callgrind, the instruction, cache, and branch counts of exactly those
+ * calls are dumped, labelled with the test name; otherwise the mean
+ * wall-clock time per call is reported.  Reported as a single test.  */
+void
+itest_run_bench(itest_test_env_cb *test_cb, const char *test_name,
+                unsigned long iterations)
+{
+    unsigned long long ns = 0;
+    int res;
+
+    if (itest_test_pre(test_name) != 1) {
+        return;
+    }
+    res = itest_bench_run(test_cb, iterations, &ns);
+    itest_test_post(res);
+    if (res != ITEST_TEST_RES_PASS || !itest_get_verbosity()) {
+        return;
+    }
+
+#if ITEST_USE_VALGRIND
+    if (RUNNING_ON_VALGRIND) {
+        /* The counts are in a dump file whose name depends on
+           Callgrind's options, and no client request gives it, so
+           leave reading them to callgrind_annotate.  */
+        fprintf(itest_info.out,
+                "    callgrind: %lu iterations, counts dumped as %s\n",
+                iterations, itest_test_name(NULL));
+        return;
+    }
+#endif
+    if (itest_get_flag(ITEST_FLAG_RECORD_TIMING)) {
+        fprintf(itest_info.out, "    %lu iterations, %.2f ns/op\n",
+                iterations,
+                (double)ns / (double)(iterations ? iterations : 1));
+    }
+}
+
+/* The splitmix64 generator: advance *X and return a well-mixed value
+   from it.  Used to seed xoshiro256**, and to derive trial seeds.  */
+static unsigned long long
+itest_splitmix64(unsigned long long *x)
+{
+    unsigned long long z = (*x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/* Start RAND on the sequence determined by SEED.  */
+void
+itest_rand_seed(itest_rand *rand, unsigned long long seed)
+{
+    int i;
+    for (i = 0; i < 4; i++) {
+        rand->s[i] = itest_splitmix64(&seed);
+    }
+}
+
+#define ITEST_ROTL64(x, k) (((x) << (k)) | ((x) >> (64 - (k))))
+
+/* Return the next value from RAND, using xoshiro256** (Blackman and
+   Vigna, 2018).  */
+unsigned long long
+itest_rand_u64(itest_rand *rand)
+{
+    unsigned long long *s = rand->s;
+    unsigned long long r  = ITEST_ROTL64(s[1] * 5, 7) * 9;
+    unsigned long long t  = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = ITEST_ROTL64(s[3], 45);
+    return r;
+}
+
+/* Return a value from RAND evenly distributed between 0 and N - 1, or
+   0 if N is 0.  */
+unsigned long long
+itest_rand_below(itest_rand *rand, unsigned long long n)
+{
+    unsigned long long limit, r;
+    if (n == 0) {
+        return 0;
+    }
+    /* Reject the values above the largest multiple of N.  */
+    limit = 0xffffffffffffffffull - 0xffffffffffffffffull % n;
+    do {
+        r = itest_rand_u64(rand);
+    } while (r >= limit);
+    return r % n;
+}
+
+/* Return a value from RAND evenly distributed in [0, 1).  */
+double
+itest_rand_double(itest_rand *rand)
+{
+    return (double)(itest_rand_u64(rand) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Pick one of the values an integer input favors: one of NSPECIAL
+   special values (by index, returned in *SPECIAL), a small value, or
+   anything at all.  Returns 0, 1 or 2 for these.  */
+static int
+itest_prop_pick(itest_rand *rand, unsigned int nspecial,
+                unsigned int *special)
+{
+    unsigned long long r = itest_rand_below(rand, 8);
+    if (r == 0) {
+        *special = (unsigned int)itest_rand_below(rand, nspecial);
+        return 0;
+    }
+    return r < 4 ? 1 : 2;
+}
+
+static void
+itest_prop_int_generate(void *value, itest_rand *rand)
+{
+    static const int special[] = { 0, 1, -1, INT_MAX, INT_MIN };
+    unsigned int i = 0;
+    int v;
+    switch (itest_prop_pick(rand, 5, &i)) {
+    case 0:
+        v = special[i];
+        break;
+    case 1:
+        v = (int)itest_rand_below(rand, 33) - 16;
+        break;
+    default:
+        v = (int)(unsigned int)itest_rand_u64(rand);
+        break;
+    }
+    memcpy(value, &v, sizeof v);
+}
+
+/* Shrink an int towards 0: to 0, to half, by one, or to its absolute
+   value.  */
+static int
+itest_prop_int_shrink(const void *value, void *smaller, unsigned int tactic)
+{
+    int v, s;
+    memcpy(&v, value, sizeof v);
+    switch (tactic) {
+    case 0:
+        s = 0;
+        break;
+    case 1:
+        s = v / 2;
+        break;
+    case 2:
+        s = v > 0 ? v - 1 : v + 1;
+        break;
+    case 3:
+        s = v < 0 && v != INT_MIN ? -v : v;
+        break;
+    default:
+        return ITEST_SHRINK_NO_MORE;
+    }
+    if (s == v || v == 0) {
+        return ITEST_SHRINK_DEAD_END;
+    }
+    memcpy(smaller, &s, sizeof s);
+    return ITEST_SHRINK_OK;
+}
+
+static void
+itest_prop_int_print(FILE *out, const void *value)
+{
+    int v;
+    memcpy(&v, value, sizeof v);
+    fprintf(out, "%d", v);
+}
+
+static void
+itest_prop_uint_generate(void *value, itest_rand *rand)
+{
+    static const unsigned int special[] = { 0, 1, UINT_MAX, INT_MAX };
+    unsigned int i = 0, v;
+    switch (itest_prop_pick(rand, 4, &i)) {
+    case 0:
+        v = special[i];
+        break;
+    case 1:
+        v = (unsigned int)itest_rand_below(rand, 17);
+        break;
+    default:
+        v = (unsigned int)itest_rand_u64(rand);
+        break;
+    }
+    memcpy(value, &v, sizeof v);
+}
+
+/* Shrink an unsigned int towards 0: to 0, to half, or by one.  */
+static int
+itest_prop_uint_shrink(const void *value, void *smaller, unsigned int tactic)
+{
+    unsigned int v, s;
+    memcpy(&v, value, sizeof v);
+    if (tactic > 2) {
+        return ITEST_SHRINK_NO_MORE;
+    }
+    if (v == 0) {
+        return ITEST_SHRINK_DEAD_END;
+    }
+    s = tactic == 0 ? 0 : tactic == 1 ? v / 2 : v - 1;
+    memcpy(smaller, &s, sizeof s);
+    return ITEST_SHRINK_OK;
+}
+
+static void
+itest_prop_uint_print(FILE *out, const void *value)
+{
+    unsigned int v;
+    memcpy(&v, value, sizeof v);
+    fprintf(out, "%u", v);
+}
+
+const itest_prop_type itest_prop_int = {
+    sizeof(int),
+    itest_prop_int_generate,
+    itest_prop_int_shrink,
+    itest_prop_int_print,
+};
+
+const itest_prop_type itest_prop_uint = {
+    sizeof(unsigned int),
+    itest_prop_uint_generate,
+    itest_prop_uint_shrink,
+    itest_prop_uint_print,
+};
+
+/* What a thread running property trials needs for itself.  */
+typedef struct itest_prop_worker
+{
+    itest_test_ctx ctx;
+    itest_rand rand;
+    void *value;
+    unsigned long passed;
+    unsigned long discarded;
+} itest_prop_worker;
+
+/* State of a test run by itest_run_property.  The itest_conc running
+   its trials comes first, so that it leads back here.  */
+typedef struct itest_prop
+{
+    itest_conc conc;
+    itest_test_env_cb *test_cb;
+    const itest_prop_type *type;
+    unsigned long long seed; /* trials' seeds are derived from this */
+    unsigned long trials;
+    unsigned long max_shrinks;
+    unsigned long next;      /* first trial not yet claimed by a thread */
+    unsigned long failed_at; /* first trial to fail, or trials */
+    itest_prop_worker *workers;
+    void *best;      /* simplest failing input so far */
+    void *candidate; /* simpler input being tried */
+} itest_prop;
+
+/* The seed of trial I of P, or the one to replay.  */
+static unsigned long long
+itest_prop_trial_seed(const itest_prop *p, unsigned long i)
+{
+    unsigned long long x = p->seed + i;
+    return itest_info.prop_replay ? itest_info.prop_seed
+                                  : itest_splitmix64(&x);
+}
+
+/* Call P's test function on VALUE, quietly, with its failures going to
+   context T.  Return the result.  */
+static int
+itest_prop_try(itest_prop *p, itest_test_ctx *t, void *value)
+{
+    itest_test_ctx *saved = itest_cur;
+    int res;
+    /* nothing carries over from the last call: each call sees the same
+       random stream, and its helper threads can claim its result */
+    memset(t, 0, sizeof *t);
+    itest_cur   = t;
+    itest_quiet = 1;
+    res         = setjmp(t->jump_dest);
+    if (res == ITEST_TEST_RES_PASS) {
+        p->test_cb(value);
+        itest_check_threads();
+    }
+    itest_quiet = 0;
+    itest_cur   = saved;
+    return res;
+}
+
+/* itest_conc test function: run the next batch of trials on the calling
+   thread.  The threads stop once every batch has been claimed, or one
+   before the first failure so far; so the first trial to fail is always
+   found, however the threads are scheduled.  */
+static void
+itest_prop_batch(void *env)
+{
+    itest_conc_thread *th = (itest_conc_thread *)env;
+    itest_prop *p         = (itest_prop *)th->conc;
+    itest_prop_worker *w  = &p->workers[th->env.thread];
+    unsigned long batch   = ITEST_PROP_BATCH;
+    unsigned long i       = ITEST_ATOMIC_FETCH_ADD(&p->next, batch);
+    unsigned long end     = i + batch;
+
+    if (i >= p->trials || i >= ITEST_ATOMIC_LOAD(&p->failed_at)) {
+        ITEST_ATOMIC_STORE(&th->conc->stop, 1u);
+        return;
+    }
+    for (; i < end && i < p->trials; i++) {
+        int res;
+        itest_rand_seed(&w->rand, itest_prop_trial_seed(p, i));
+        p->type->generate(w->value, &w->rand);
+        res = itest_prop_try(p, &w->ctx, w->value);
+        if (res == ITEST_TEST_RES_FAIL) {
+            unsigned long first = ITEST_ATOMIC_LOAD(&p->failed_at);
+            while (i < first && !ITEST_ATOMIC_CAS(&p->failed_at, &first, i)) {
             }
+            return;
         }
-        if (g->running_test) {
-            fprintf(stderr, "Error: Test run inside another test.\n");
-            return 0;
-        }
-        g->suite.pre_test = itest_get_cpu_time();
-        if (g->setup) {
-            g->setup(g->setup_udata);
+        if (res == ITEST_TEST_RES_SKIP) {
+            w->discarded++;
+        } else {
+            w->passed++;
         }
-        p->count_run++;
-        g->running_test = 1;
-        return 1; /* test should be run */
-    } else {
-        goto clear; /* skipped */
     }
-clear:
-    g->name_suffix = NULL;
-    return 0;
 }
 
 static void
-itest_do_pass(void)
+itest_prop_free(itest_prop *p)
 {
-    struct itest_run_info *g = &itest_info;
-    if (itest_get_verbosity()) {
-        fprintf(itest_info.out, "PASS %s: %s", g->name_buf,
-                g->msg ? g->msg : "");
-    } else {
-        fprintf(itest_info.out, ".");
+    unsigned int i;
+    if (p->workers != NULL) {
+        for (i = 0; i < p->conc.nthreads; i++) {
+            free(p->workers[i].value);
+        }
     }
-    g->suite.passed++;
+    free(p->workers);
+    free(p->conc.threads);
+    free(p->best);
+    free(p->candidate);
 }
 
-static void
-itest_do_fail(void)
+/* Set up P to try TYPE's inputs on TEST_CB as SPEC says.  Returns 0 if
+   out of memory.  */
+static int
+itest_prop_init(itest_prop *p, itest_test_env_cb *test_cb,
+                const itest_prop_type *type, const itest_prop_spec *spec)
 {
-    struct itest_run_info *g = &itest_info;
-    if (itest_get_verbosity()) {
-        fprintf(itest_info.out, "FAIL %s: %s (%s:%u)", g->name_buf,
-                g->msg ? g->msg : "", g->fail_file, g->fail_line);
-    } else {
-        fprintf(itest_info.out, "F");
-        g->col++; /* add linebreak if in line of '.'s */
-        if (g->col != 0) {
-            fprintf(itest_info.out, "\n");
-            g->col = 0;
+    static const itest_prop_spec defaults = { 0, 0, 0, 0 };
+    unsigned long batches;
+    unsigned int nthreads, i;
+
+    if (spec == NULL) {
+        spec = &defaults;
+    }
+    memset(p, 0, sizeof *p);
+    p->test_cb     = test_cb;
+    p->type        = type;
+    p->trials      = spec->trials ? spec->trials : ITEST_PROP_TRIALS;
+    p->max_shrinks = spec->max_shrinks ? spec->max_shrinks
+                                       : ITEST_PROP_SHRINKS;
+    if (itest_info.prop_replay) {
+        p->trials = 1;
+    }
+    p->failed_at = p->trials;
+    p->seed      = spec->seed;
+    if (p->seed == 0) {
+        p->seed = itest_name_seed(NULL);
+        ITEST_ATOMIC_STORE(&itest_info.rand_used, 1u);
+    }
+
+    nthreads = spec->nthreads ? spec->nthreads : itest_get_jobs();
+    batches  = (p->trials + ITEST_PROP_BATCH - 1) / ITEST_PROP_BATCH;
+    if (nthreads > batches) {
+        nthreads = (unsigned int)batches;
+    }
+    p->conc.test_cb    = itest_prop_batch;
+    p->conc.iterations = ULONG_MAX;
+    p->conc.threads =
+        (itest_conc_thread *)calloc(nthreads, sizeof(itest_conc_thread));
+    p->workers =
+        (itest_prop_worker *)calloc(nthreads, sizeof(itest_prop_worker));
+    p->best      = malloc(type->size ? type->size : 1);
+    p->candidate = malloc(type->size ? type->size : 1);
+    if (!p->conc.threads || !p->workers || !p->best || !p->candidate) {
+        return 0;
+    }
+    itest_conc_reset(&p->conc, nthreads);
+    for (i = 0; i < nthreads; i++) {
+        p->workers[i].value = malloc(type->size ? type->size : 1);
+        if (p->workers[i].value == NULL) {
+            return 0;
         }
-        fprintf(itest_info.out, "FAIL %s: %s (%s:%u)\n", g->name_buf,
-                g->msg ? g->msg : "", g->fail_file, g->fail_line);
     }
-    g->suite.failed++;
+    if (itest_info.quiet_out == NULL) {
+        itest_info.quiet_out = fopen("/dev/null", "w");
+    }
+    return 1;
 }
 
-static void
-itest_do_skip(void)
+/* Replace P->best with simpler inputs that still fail, for as long as
+   P's type can find them.  Trials are run in context T.  Returns the
+   number of times P->best was replaced.  */
+static unsigned long
+itest_prop_shrink(itest_prop *p, itest_test_ctx *t)
 {
-    struct itest_run_info *g = &itest_info;
-    if (itest_get_verbosity()) {
-        fprintf(itest_info.out, "SKIP %s: %s", g->name_buf,
-                g->msg ? g->msg : "");
-    } else {
-        fprintf(itest_info.out, "s");
+    unsigned long shrinks = 0, tries = 0;
+    unsigned int tactic   = 0;
+    if (p->type->shrink == NULL) {
+        return 0;
     }
-    g->suite.skipped++;
+    while (tries < p->max_shrinks) {
+        int r = p->type->shrink(p->best, p->candidate, tactic);
+        if (r == ITEST_SHRINK_NO_MORE) {
+            break;
+        }
+        if (r == ITEST_SHRINK_OK) {
+            tries++;
+            if (itest_prop_try(p, t, p->candidate) == ITEST_TEST_RES_FAIL) {
+                memcpy(p->best, p->candidate, p->type->size);
+                shrinks++;
+                tactic = 0;
+                continue;
+            }
+        }
+        tactic++;
+    }
+    return shrinks;
 }
 
-void
-itest_test_post(int res)
+/* Run P's trials.  If one fails, shrink its input, report it, and fail
+   the current test with it.  */
+static void
+itest_prop_check(itest_prop *p)
 {
-    itest_info.suite.post_test = itest_get_cpu_time();
-    if (itest_info.teardown) {
-        void *udata = itest_info.teardown_udata;
-        itest_info.teardown(udata);
+    itest_prop_worker *w = &p->workers[0];
+    unsigned long passed = 0, discarded = 0, shrinks;
+    unsigned long long seed;
+    unsigned int i;
+
+    itest_conc_run(&p->conc);
+    for (i = 0; i < p->conc.nthreads; i++) {
+        passed += p->workers[i].passed;
+        discarded += p->workers[i].discarded;
+    }
+    if (p->failed_at == p->trials) {
+        if (passed == 0 && discarded > 0) {
+            itest_skip("every input was discarded", __FILE__, __LINE__);
+        }
+        return;
     }
 
-    itest_info.running_test = 0;
-    switch (res) {
-    case ITEST_TEST_RES_PASS:
-        itest_do_pass();
-        break;
+    seed = itest_prop_trial_seed(p, p->failed_at);
+    itest_rand_seed(&w->rand, seed);
+    p->type->generate(p->best, &w->rand);
+    shrinks = itest_prop_shrink(p, &w->ctx);
+    fprintf(itest_info.out,
+            "\nCounterexample from trial %lu of %lu, shrunk %lu time%s"
+            " (--prop-seed 0x%llx)",
+            p->failed_at + 1, p->trials, shrinks, shrinks == 1 ? "" : "s",
+            seed);
+    if (p->type->print != NULL) {
+        fputs(":\n  ", itest_info.out);
+        p->type->print(itest_info.out, p->best);
+    }
+    fputc('\n', itest_info.out);
 
-    case ITEST_TEST_RES_SKIP:
-        itest_do_skip();
-        break;
+    p->test_cb(p->best);
+    itest_check_threads();
+    itest_fail("counterexample passed when run again", __FILE__, __LINE__);
+}
 
-    /* FIXME introduce a fail/error distinction.  */
-    case ITEST_TEST_RES_FAIL:
-    default:
-        itest_do_fail();
-        break;
+/* Test a property: run a test function on many random inputs, and
+ * shrink the first that fails to a simpler counterexample.  Reported
+ * as a single test.  */
+void
+itest_run_property(itest_test_env_cb *test_cb, const char *test_name,
+                   const itest_prop_type *type, const itest_prop_spec *spec)
+{
+    itest_prop p;
+    int res;
+
+    if (itest_test_pre(test_name) != 1) {
+        return;
+    }
+    if (!itest_prop_init(&p, test_cb, type, spec)) {
+        itest_prop_free(&p);
+        itest_info.test.msg       = "out of memory";
+        itest_info.test.fail_file = __FILE__;
+        itest_info.test.fail_line = __LINE__;
+        itest_test_post(ITEST_TEST_RES_FAIL);
+        return;
     }
 
-    itest_info.name_suffix = NULL;
-    itest_info.suite.tests_run++;
-    itest_info.col++;
-    if (itest_get_verbosity()) {
-        itest_report_interval(itest_info.suite.pre_test,
-                              itest_info.suite.post_test);
-        fprintf(itest_info.out, "\n");
-    } else if (itest_info.col % itest_info.width == 0) {
-        fprintf(itest_info.out, "\n");
-        itest_info.col = 0;
+    res = setjmp(itest_info.test.jump_dest);
+    if (res == ITEST_TEST_RES_PASS) {
+        itest_prop_check(&p);
     }
-    fflush(itest_info.out);
+    itest_test_post(res);
+    if (res == ITEST_TEST_RES_PASS && itest_get_verbosity()) {
+        unsigned long discarded = 0;
+        unsigned int i;
+        for (i = 0; i < p.conc.nthreads; i++) {
+            discarded += p.workers[i].discarded;
+        }
+        fprintf(itest_info.out,
+                "    %lu trials, %lu discarded (seed 0x%llx)\n", p.trials,
+                discarded, p.seed);
+    }
+    itest_prop_free(&p);
+}
+
+/* Make every property test run only the trial with SEED, as printed
+ * with a counterexample.  */
+void
+itest_set_prop_seed(unsigned long long seed)
+{
+    itest_info.prop_seed   = seed;
+    itest_info.prop_replay = 1;
 }
 
 static void
 report_suite(void)
 {
     if (itest_info.suite.tests_run > 0) {
+        itest_suite_info *s = &itest_info.suite;
+        /* the suite's hooks are reported separately */
+        unsigned long hooks = s->suite_setup_ticks + s->suite_teardown_ticks;
         fprintf(itest_info.out,
                 "\n%u test%s - %u passed, %u failed, %u skipped",
                 itest_info.suite.tests_run,
                 itest_info.suite.tests_run == 1 ? "" : "s",
                 itest_info.suite.passed, itest_info.suite.failed,
                 itest_info.suite.skipped);
-        itest_report_interval(itest_info.suite.pre_suite,
-                              itest_info.suite.post_suite);
+        itest_report_phases((clock_t)((unsigned long)s->pre_suite + hooks),
+                            itest_info.suite.post_suite,
+                            itest_info.suite.fixture_tests > 0,
+                            itest_info.suite.setup_ticks,
+                            itest_info.suite.body_ticks,
+                            itest_info.suite.teardown_ticks);
         fprintf(itest_info.out, "\n");
+        if ((s->suite_setup != NULL || s->suite_teardown != NULL)
+            && itest_get_flag(ITEST_FLAG_RECORD_TIMING)) {
+            fprintf(itest_info.out,
+                    "Suite setup %lu ticks, teardown %lu ticks\n",
+                    s->suite_setup_ticks, s->suite_teardown_ticks);
+        }
     }
 }
 
 static void
 update_counts_and_reset_suite(void)
 {
+    itest_join_parallel();
+    itest_suite_teardown(); /* tests run outside any suite had hooks */
     itest_info.setup          = NULL;
     itest_info.setup_udata    = NULL;
     itest_info.teardown       = NULL;
@@ -523,6 +5229,8 @@ itest_suite_pre(const char *suite_name)
     }
     p->count_run++;
     update_counts_and_reset_suite();
+    itest_info.suite.name       = suite_name;
+    itest_info.suite.wall_begin = itest_trace_now();
     fprintf(itest_info.out, "\n* Suite %s:\n", suite_name);
     itest_info.suite.pre_suite = itest_get_cpu_time();
     return 1;
@@ -531,8 +5239,13 @@ itest_suite_pre(const char *suite_name)
 static void
 itest_suite_post(void)
 {
+    itest_join_parallel();
+    itest_suite_teardown();
     itest_info.suite.post_suite = itest_get_cpu_time();
     report_suite();
+    itest_trace_add(ITEST_TRACE_SUITE, itest_info.suite.name,
+                    itest_info.suite.wall_begin, itest_trace_now(), 0, 0);
+    itest_trace_flush();
 }
 
 void
@@ -544,37 +5257,116 @@ itest_run_suite(itest_suite_cb *suite_cb, const char *suite_name)
     }
 }
 
+/* Run a suite, treating every test in it as parallel-safe. */
+void
+itest_run_suite_parallel(itest_suite_cb *suite_cb, const char *suite_name)
+{
+    if (itest_suite_pre(suite_name)) {
+        itest_info.suite.parallel = 1;
+        suite_cb();
+        itest_suite_post();
+    }
+}
+
 void
 itest_assert(const char *msg, const char *file, unsigned int line, int cond)
 {
-    itest_info.assertions++;
+    ITEST_ATOMIC_INC(&itest_info.assertions);
+    itest_count_assert(file, line);
     if (!cond) {
         itest_fail(msg, file, line);
     }
 }
 
+/* The failure path of the inline assertions.  */
+ITEST_NORETURN
+itest_assert_failed(const char *msg, const char *file, unsigned int line)
+{
+    ITEST_ATOMIC_INC(&itest_info.assertions);
+    itest_count_assert(file, line);
+    itest_fail(msg, file, line);
+}
+
+/* The failure path of ITEST_ASSERTf and ITEST_ASSERT_FALSEf.  */
+ITEST_NORETURN
+itest_assert_failedf(const char *file, unsigned int line, const char *fmt,
+                     ...)
+{
+    va_list ap;
+    ITEST_ATOMIC_INC(&itest_info.assertions);
+    itest_count_assert(file, line);
+    va_start(ap, fmt);
+    vsnprintf(itest_fmt_buf, sizeof itest_fmt_buf, fmt, ap);
+    va_end(ap);
+    itest_fail(itest_fmt_buf, file, line);
+}
+
 void
 itest_assert_eq_fmt(const char *msg, const char *file, unsigned int line,
                     const char *fmt, int cond, ...)
 {
-    itest_info.assertions++;
+    ITEST_ATOMIC_INC(&itest_info.assertions);
+    itest_count_assert(file, line);
     if (!cond) {
         va_list ap;
         va_start(ap, cond);
-        vfprintf(itest_info.out, fmt, ap);
+        vfprintf(itest_detail_out(), fmt, ap);
         va_end(ap);
         itest_fail(msg, file, line);
     }
 }
 
+/* True if EXP OP GOT, for an itest_cmp_op OP. */
+#define ITEST_COMPARE(op, exp, got)                                          \
+    ((op) == ITEST_CMP_EQ    ? (exp) == (got)                                \
+     : (op) == ITEST_CMP_NEQ ? (exp) != (got)                                \
+     : (op) == ITEST_CMP_GT  ? (exp) > (got)                                 \
+     : (op) == ITEST_CMP_GTE ? (exp) >= (got)                                \
+     : (op) == ITEST_CMP_LT  ? (exp) < (got)                                 \
+                             : (exp) <= (got))
+
+/* Define itest_assert_cmp_NAME, for operands of type T.  They are
+ * printed with DEFAULT_FMT unless the caller supplies a format.  */
+#define ITEST_DEFINE_ASSERT_CMP(NAME, T, DEFAULT_FMT)                        \
+    void itest_assert_cmp_##NAME(const char *msg, const char *file,          \
+                                 unsigned int line, itest_cmp_op op,         \
+                                 const char *fmt, T exp, T got)              \
+    {                                                                        \
+        ITEST_ATOMIC_INC(&itest_info.assertions);                            \
+        itest_count_assert(file, line);                                      \
+        if (!ITEST_COMPARE(op, exp, got)) {                                  \
+            FILE *out = itest_detail_out();                                  \
+            if (!fmt) {                                                      \
+                fmt = DEFAULT_FMT;                                           \
+            }                                                                \
+            fputs("\nExpected: ", out);                                      \
+            fprintf(out, fmt, exp);                                          \
+            fputs("\n     Got: ", out);                                      \
+            fprintf(out, fmt, got);                                          \
+            fputc('\n', out);                                                \
+            itest_fail(msg, file, line);                                     \
+        }                                                                    \
+    }
+
+ITEST_DEFINE_ASSERT_CMP(int, int, "%d")
+ITEST_DEFINE_ASSERT_CMP(uint, unsigned int, "%u")
+ITEST_DEFINE_ASSERT_CMP(long, long, "%ld")
+ITEST_DEFINE_ASSERT_CMP(ulong, unsigned long, "%lu")
+ITEST_DEFINE_ASSERT_CMP(llong, long long, "%lld")
+ITEST_DEFINE_ASSERT_CMP(ullong, unsigned long long, "%llu")
+ITEST_DEFINE_ASSERT_CMP(double, double, "%.17g")
+ITEST_DEFINE_ASSERT_CMP(ldouble, long double, "%.21Lg")
+ITEST_DEFINE_ASSERT_CMP(ptr, const void *, "%p")
+
 void
 itest_assert_eq_enum(const char *msg, const char *file, unsigned int line,
                      itest_enum_str_fun enum_str, int exp, int got)
 {
-    itest_info.assertions++;
+    ITEST_ATOMIC_INC(&itest_info.assertions);
+    itest_count_assert(file, line);
     if (exp != got) {
-        fprintf(itest_info.out, "\nExpected: %s", enum_str(exp));
-        fprintf(itest_info.out, "\n     Got: %s\n", enum_str(got));
+        fprintf(itest_detail_out(), "\nExpected: %s", enum_str(exp));
+        fprintf(itest_detail_out(), "\n     Got: %s\n", enum_str(got));
         itest_fail(msg, file, line);
     }
 }
@@ -583,9 +5375,12 @@ void
 itest_assert_in_range(const char *msg, const char *file, unsigned int line,
                       double exp, double got, double tol)
 {
-    itest_info.assertions++;
-    if ((exp > got && exp - got > tol) || (exp < got && got - exp > tol)) {
-        fprintf(itest_info.out,
+    double d = exp > got ? exp - got : got - exp;
+    ITEST_ATOMIC_INC(&itest_info.assertions);
+    itest_count_assert(file, line);
+    /* NaN is only in range of NaN, and infinity of itself */
+    if (exp != got && !(d <= tol) && !(exp != exp && got != got)) {
+        fprintf(itest_detail_out(),
                 "\nExpected: %g +/- %g"
                 "\n     Got: %g\n",
                 exp, tol, got);
@@ -598,13 +5393,14 @@ itest_assert_equal_t(const char *msg, const char *file, unsigned int line,
                      const void *exp, const void *got,
                      const itest_type_info *type_info, void *udata)
 {
-    itest_info.assertions++;
+    ITEST_ATOMIC_INC(&itest_info.assertions);
+    itest_count_assert(file, line);
     if (type_info == NULL || type_info->equal == NULL) {
         itest_fail("type_info->equal callback missing!", file, line);
     }
     if (!type_info->equal(exp, got, udata)) {
         if (type_info->print != NULL) {
-            FILE *out = itest_info.out;
+            FILE *out = itest_detail_out();
             fputs("\nExpected: ", out);
             (void)type_info->print(out, exp, udata);
             fputs("\n     Got: ", out);
@@ -643,11 +5439,292 @@ itest_assert_equal_mem(const char *msg, const char *file, unsigned int line,
                          &env);
 }
 
+/* Print the row of 16 bytes of the SIZE bytes at P around offset AT,
+   as itest_memory_fprintf_cb does, marking the ones that differ from
+   the SIZE2 bytes at P2.  */
+static void
+itest_golden_row(FILE *out, const char *label, const unsigned char *p,
+                 size_t size, const unsigned char *p2, size_t size2,
+                 size_t at)
+{
+    size_t i, start = at & ~(size_t)15;
+    fprintf(out, "\n%s%08lx ", label, (unsigned long)start);
+    for (i = start; i < start + 16; i++) {
+        if (i < size) {
+            int m = i < size2 && p[i] == p2[i]; /* match? */
+            fprintf(out, "%02x%c", p[i], m ? ' ' : '<');
+        } else {
+            fputs("   ", out);
+        }
+    }
+    fputc(' ', out);
+    for (i = start; i < start + 16 && i < size; i++) {
+        fputc(isprint(p[i]) ? p[i] : '.', out);
+    }
+}
+
+/* Replace the file at PATH with the SIZE bytes at DATA: write them to
+   a new file next to it, then rename that over it, so PATH is never
+   left partly written.  Returns 0, with errno set, on failure.  */
+static int
+itest_write_golden(const char *path, const void *data, size_t size)
+{
+    size_t len = strlen(path);
+    char *tmp  = (char *)malloc(len + sizeof ".new");
+    FILE *f;
+    int ok;
+    if (tmp == NULL) {
+        errno = ENOMEM;
+        return 0;
+    }
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, ".new", sizeof ".new");
+    f = fopen(tmp, "wb");
+    if (f == NULL) {
+        free(tmp);
+        return 0;
+    }
+    ok = fwrite(data, 1, size, f) == size;
+    ok = fclose(f) == 0 && ok;
+    /* Windows' rename won't replace a file; elsewhere it's atomic.  */
+    if (ok && rename(tmp, path) != 0) {
+        ok = remove(path) == 0 && rename(tmp, path) == 0;
+    }
+    if (!ok) {
+        int err = errno;
+        remove(tmp);
+        errno = err;
+    }
+    free(tmp);
+    return ok;
+}
+
+/* Check the SIZE bytes at GOT against the golden file at PATH, or with
+   --update-golden, replace the file with them if they differ.  Returns
+   0, having printed why, if the check failed.  */
+static int
+itest_check_golden(const char *path, const unsigned char *got, size_t size)
+{
+    FILE *out;
+    itest_mapped_file m;
+    size_t i, n;
+    if (!itest_map_file(path, &m)) {
+        if (errno != ENOENT || !itest_get_flag(ITEST_FLAG_UPDATE_GOLDEN)) {
+            fprintf(itest_detail_out(), "\ncannot read golden file %s: %s\n",
+                    path, strerror(errno));
+            return 0;
+        }
+    } else if (m.size == size && memcmp(m.data, got, size) == 0) {
+        itest_unmap_file(&m);
+        return 1;
+    }
+
+    if (itest_get_flag(ITEST_FLAG_UPDATE_GOLDEN)) {
+        itest_unmap_file(&m);
+        if (!itest_write_golden(path, got, size)) {
+            fprintf(itest_detail_out(),
+                    "\ncannot update golden file %s: %s\n", path,
+                    strerror(errno));
+            return 0;
+        }
+        ITEST_ATOMIC_INC(&itest_info.golden_updated);
+        return 1;
+    }
+
+    n = m.size < size ? m.size : size;
+    for (i = 0; i < n && m.data[i] == got[i]; i++) {
+    }
+    out = itest_detail_out();
+    fprintf(out,
+            "\nGolden file %s differs at offset %lu (%lu bytes, got %lu)",
+            path, (unsigned long)i, (unsigned long)m.size,
+            (unsigned long)size);
+    itest_golden_row(out, "Expected: ", m.data, m.size, got, size, i);
+    itest_golden_row(out, "     Got: ", got, size, m.data, m.size, i);
+    fputc('\n', out);
+    itest_unmap_file(&m);
+    return 0;
+}
+
+void
+itest_assert_golden(const char *msg, const char *file, unsigned int line,
+                    const char *path, const void *got, size_t size)
+{
+    ITEST_ATOMIC_INC(&itest_info.assertions);
+    itest_count_assert(file, line);
+    if (!itest_check_golden(path, (const unsigned char *)got, size)) {
+        itest_fail(msg, file, line);
+    }
+}
+
+void
+itest_assert_golden_file(const char *msg, const char *file,
+                         unsigned int line, const char *path,
+                         const char *got_path)
+{
+    itest_mapped_file got;
+    int ok;
+    ITEST_ATOMIC_INC(&itest_info.assertions);
+    itest_count_assert(file, line);
+    if (!itest_map_file(got_path, &got)) {
+        fprintf(itest_detail_out(), "\ncannot read %s: %s\n", got_path,
+                strerror(errno));
+        itest_fail(msg, file, line);
+    }
+    ok = itest_check_golden(path, got.data, got.size);
+    itest_unmap_file(&got);
+    if (!ok) {
+        itest_fail(msg, file, line);
+    }
+}
+
+void
+itest_assert_array_eq(const char *msg, const char *file, unsigned int line,
+                      itest_elem_kind kind, const void *exp, const void *got,
+                      size_t count, size_t size)
+{
+    itest_check_elems(msg, file, line, kind, size, exp, 0, got, count);
+}
+
+void
+itest_assert_all_eq(const char *msg, const char *file, unsigned int line,
+                    itest_elem_kind kind, unsigned long long exp,
+                    const void *got, size_t count, size_t size)
+{
+    /* the element to compare with, converted to the elements' type */
+    union
+    {
+        unsigned char c;
+        unsigned short s;
+        unsigned int i;
+        unsigned long long ll;
+    } e;
+    if (size == sizeof(unsigned char)) {
+        e.c = (unsigned char)exp;
+    } else if (size == sizeof(unsigned short)) {
+        e.s = (unsigned short)exp;
+    } else if (size == sizeof(unsigned int)) {
+        e.i = (unsigned int)exp;
+    } else {
+        e.ll = exp;
+    }
+    itest_check_elems(msg, file, line, kind, size, &e, 1, got, count);
+}
+
+void
+itest_assert_all_eq_fp(const char *msg, const char *file, unsigned int line,
+                       double exp, const void *got, size_t count, size_t size)
+{
+    union
+    {
+        float f;
+        double d;
+    } e;
+    if (size == sizeof(float)) {
+        e.f = (float)exp;
+    } else {
+        e.d = exp;
+    }
+    itest_check_elems(msg, file, line, ITEST_ELEM_FP, size, &e, 1, got,
+                      count);
+}
+
+void
+itest_assert_within_ulps(const char *msg, const char *file,
+                         unsigned int line, double exp, double got,
+                         unsigned long ulps, size_t size)
+{
+    if (size == sizeof(float)) {
+        float e = (float)exp, g = (float)got;
+        itest_check_fp_elems(msg, file, line, ITEST_FP_ULPS, (double)ulps, &e,
+                             &g, 1, size);
+    } else {
+        itest_check_fp_elems(msg, file, line, ITEST_FP_ULPS, (double)ulps,
+                             &exp, &got, 1, sizeof(double));
+    }
+}
+
+void
+itest_assert_within_rel(const char *msg, const char *file, unsigned int line,
+                        double exp, double got, double tol, size_t size)
+{
+    if (size == sizeof(float)) {
+        float e = (float)exp, g = (float)got;
+        itest_check_fp_elems(msg, file, line, ITEST_FP_REL, tol, &e, &g, 1,
+                             size);
+    } else {
+        itest_check_fp_elems(msg, file, line, ITEST_FP_REL, tol, &exp, &got,
+                             1, sizeof(double));
+    }
+}
+
+void
+itest_assert_array_within_ulps(const char *msg, const char *file,
+                               unsigned int line, const void *exp,
+                               const void *got, size_t count, size_t size,
+                               unsigned long ulps)
+{
+    itest_check_fp_elems(msg, file, line, ITEST_FP_ULPS, (double)ulps, exp,
+                         got, count, size);
+}
+
+void
+itest_assert_array_within_rel(const char *msg, const char *file,
+                              unsigned int line, const void *exp,
+                              const void *got, size_t count, size_t size,
+                              double tol)
+{
+    itest_check_fp_elems(msg, file, line, ITEST_FP_REL, tol, exp, got, count,
+                         size);
+}
+
+void
+itest_assert_array_equal_t(const char *msg, const char *file,
+                           unsigned int line, const void *exp,
+                           const void *got, size_t count, size_t size,
+                           const itest_type_info *type_info, void *udata)
+{
+    const unsigned char *e = (const unsigned char *)exp;
+    const unsigned char *g = (const unsigned char *)got;
+    size_t mismatches = 0, shown, i;
+    FILE *out;
+    ITEST_ATOMIC_INC(&itest_info.assertions);
+    itest_count_assert(file, line);
+    if (type_info == NULL || type_info->equal == NULL) {
+        itest_fail("type_info->equal callback missing!", file, line);
+    }
+    for (i = 0; i < count; i++) {
+        mismatches += !type_info->equal(e + i * size, g + i * size, udata);
+    }
+    if (mismatches == 0) {
+        return;
+    }
+    out = itest_detail_out();
+    itest_report_mismatch_count(mismatches, count);
+    for (i = 0, shown = 0; i < count && shown < ITEST_ARRAY_MISMATCHES;
+         i++) {
+        if (!type_info->equal(e + i * size, g + i * size, udata)) {
+            fprintf(out, "  [%lu]", (unsigned long)i);
+            if (type_info->print != NULL) {
+                fputs(" expected ", out);
+                (void)type_info->print(out, e + i * size, udata);
+                fputs(", got ", out);
+                (void)type_info->print(out, g + i * size, udata);
+            }
+            fputc('\n', out);
+            shown++;
+        }
+    }
+    itest_report_mismatch_rest(mismatches);
+    itest_fail(msg, file, line);
+}
+
 static void
 itest_usage(const char *name)
 {
     fprintf(stderr,
-            "Usage: %s [-hlfavexT] [-s SUITE] [-t TEST] [-x EXCLUDE]\n"
+            "Usage: %s [-hlfavexTPRA] [-s SUITE] [-t TEST] [-x EXCLUDE]"
+            " [-j JOBS]\n"
             "  -h, --help  print this Help\n"
             "  -l          List suites and tests, then exit (dry run)\n"
             "  -f          Stop runner after first failure\n"
@@ -657,7 +5734,28 @@ itest_usage(const char *name)
             "  -t TEST     only run tests containing substring TEST\n"
             "  -e          only run exact name match for -s or -t\n"
             "  -x EXCLUDE  exclude tests containing substring EXCLUDE\n"
-            "  -T          don't record CPU time for each test\n",
+            "  -j JOBS     run parallel-safe tests on JOBS threads\n"
+            "              (0 = one per CPU)\n"
+            "  -T          don't record CPU time for each test\n"
+            "  -P          count CPU events (instructions, cache misses,\n"
+            "              page faults, ...) for each test\n"
+            "  -R          record resource usage (memory, page faults,\n"
+            "              context switches, I/O) for each test\n"
+            "  -A          count assertions by call site, and list the\n"
+            "              most frequent for each test and the run\n"
+            "  --profile DIR       sample each test's stack, and write\n"
+            "                      the samples to DIR for flame graphs\n"
+            "                      (not tests run on -j's threads)\n"
+            "  --profile-rate HZ   take HZ samples per CPU second\n"
+            "  --trace FILE        write a timeline of the run to FILE,\n"
+            "                      in Chrome trace-event format\n"
+            "  --fork              run each test, except those run in\n"
+            "                      parallel, in a process of its own\n"
+            "  --update-golden     rewrite golden files that don't match,\n"
+            "                      instead of failing\n"
+            "  --seed SEED         seed random streams with SEED, or\n"
+            "                      with a new seed if SEED is 'random'\n"
+            "  --prop-seed SEED    run only the property trial with SEED\n",
             name);
 }
 
@@ -668,7 +5766,8 @@ itest_parse_options(int argc, char **argv)
     for (i = 1; i < argc; i++) {
         if (argv[i][0] == '-') {
             char f = argv[i][1];
-            if ((f == 's' || f == 't' || f == 'x') && argc <= i + 1) {
+            if ((f == 's' || f == 't' || f == 'x' || f == 'j')
+                && argc <= i + 1) {
                 itest_usage(argv[0]);
                 exit(EXIT_FAILURE);
             }
@@ -685,6 +5784,10 @@ itest_parse_options(int argc, char **argv)
                 itest_set_test_exclude(argv[i + 1]);
                 i++;
                 break;
+            case 'j': /* thread pool size */
+                itest_set_jobs((unsigned int)strtoul(argv[i + 1], NULL, 10));
+                i++;
+                break;
             case 'e': /* exact name match */
                 itest_set_exact_name_match();
                 break;
@@ -703,6 +5806,15 @@ itest_parse_options(int argc, char **argv)
             case 'T': /* don't record timing */
                 itest_clear_flag(ITEST_FLAG_RECORD_TIMING);
                 break;
+            case 'P': /* count events */
+                itest_set_flag(ITEST_FLAG_PERF_COUNTERS);
+                break;
+            case 'R': /* record resource usage */
+                itest_set_flag(ITEST_FLAG_RUSAGE);
+                break;
+            case 'A': /* count assertions by call site */
+                itest_set_flag(ITEST_FLAG_ASSERT_SITES);
+                break;
             case 'h': /* help */
                 itest_usage(argv[0]);
                 exit(EXIT_SUCCESS);
@@ -711,6 +5823,45 @@ itest_parse_options(int argc, char **argv)
                 if (0 == strncmp("--help", argv[i], 6)) {
                     itest_usage(argv[0]);
                     exit(EXIT_SUCCESS);
+                } else if (0 == strcmp("--profile", argv[i])
+                           && i + 1 < argc) {
+                    itest_set_profile(argv[i + 1], itest_info.profile_hz);
+                    i++;
+                    break;
+                } else if (0 == strcmp("--fork", argv[i])) {
+                    itest_set_flag(ITEST_FLAG_FORK);
+                    break;
+                } else if (0 == strcmp("--update-golden", argv[i])) {
+                    itest_set_flag(ITEST_FLAG_UPDATE_GOLDEN);
+                    break;
+                } else if (0 == strcmp("--trace", argv[i]) && i + 1 < argc) {
+                    itest_set_trace(argv[i + 1]);
+                    i++;
+                    break;
+                } else if (0 == strcmp("--profile-rate", argv[i])
+                           && i + 1 < argc) {
+                    itest_info.profile_hz =
+                        (unsigned int)strtoul(argv[i + 1], NULL, 10);
+                    if (itest_info.profile_hz == 0) {
+                        itest_info.profile_hz = ITEST_PROFILE_HZ;
+                    }
+                    i++;
+                    break;
+                } else if (0 == strcmp("--seed", argv[i]) && i + 1 < argc) {
+                    unsigned long long seed =
+                        itest_get_wall_time_ns()
+                        ^ (unsigned long long)time(NULL) << 20;
+                    if (0 != strcmp("random", argv[i + 1])) {
+                        seed = strtoull(argv[i + 1], NULL, 0);
+                    }
+                    itest_set_seed(seed);
+                    i++;
+                    break;
+                } else if (0 == strcmp("--prop-seed", argv[i])
+                           && i + 1 < argc) {
+                    itest_set_prop_seed(strtoull(argv[i + 1], NULL, 0));
+                    i++;
+                    break;
                 } else if (0 == strcmp("--", argv[i])) {
                     return; /* ignore following arguments */
                 }
@@ -780,6 +5931,7 @@ itest_list_only(void)
 void
 itest_get_report(struct itest_report_t *report)
 {
+    itest_flush_inline_assertions();
     if (report) {
         report->passed     = itest_info.passed;
         report->failed     = itest_info.failed;
@@ -809,13 +5961,13 @@ itest_get_flag(itest_flag_t flag)
 void
 itest_set_flag(itest_flag_t flag)
 {
-    itest_info.flags = (unsigned char)(itest_info.flags | flag);
+    itest_info.flags |= (unsigned int)flag;
 }
 
 void
 itest_clear_flag(itest_flag_t flag)
 {
-    itest_info.flags = (unsigned char)(itest_info.flags & ~flag);
+    itest_info.flags &= ~(unsigned int)flag;
 }
 
 void
@@ -838,6 +5990,55 @@ itest_set_teardown_cb(itest_teardown_cb *cb, void *udata)
     itest_info.teardown_udata = udata;
 }
 
+/* Set hooks to run once for the current suite: SETUP before its first
+ * test that runs, and TEARDOWN after its last.  Call this at the start
+ * of the suite, before running any test.  */
+void
+itest_set_suite_fixture(itest_setup_cb *setup, itest_teardown_cb *teardown,
+                        void *udata)
+{
+    itest_info.suite.suite_setup    = setup;
+    itest_info.suite.suite_teardown = teardown;
+    itest_info.suite.suite_udata    = udata;
+    itest_info.suite.suite_state    = 0;
+}
+
+/* Use N threads to run parallel-safe tests; 0 means one per CPU. */
+void
+itest_set_jobs(unsigned int n)
+{
+#if ITEST_PARALLEL
+    if (n == 0) {
+        n = itest_cpu_count();
+    }
+#endif
+    itest_info.jobs = n > 0 ? n : 1;
+}
+
+/* Write a timeline of the run to PATH, in Chrome trace-event format.
+ * A PATH of NULL turns this off.  */
+void
+itest_set_trace(const char *path)
+{
+    itest_info.trace_path = path;
+}
+
+/* Sample the stack of each test ITEST_PROFILE_HZ times per CPU second
+ * (or HZ times, if it isn't 0), and write the samples to DIR in folded
+ * form.  A DIR of NULL turns profiling off.  */
+void
+itest_set_profile(const char *dir, unsigned int hz)
+{
+    itest_info.profile_dir = dir;
+    itest_info.profile_hz  = hz > 0 ? hz : ITEST_PROFILE_HZ;
+}
+
+unsigned int
+itest_get_jobs(void)
+{
+    return itest_info.jobs;
+}
+
 void
 itest_set_output(FILE *fp)
 {
@@ -913,10 +6114,26 @@ itest_shuffle_running(unsigned int id)
 void
 itest_init(void)
 {
+    free(itest_info.queue);
+    free(itest_info.prof_frames);
+    free(itest_info.prof_depth);
+    free(itest_info.trace);
+    free(itest_info.trace_names);
+    free(itest_info.sites);
+    if (itest_info.trace_fp) {
+        fclose(itest_info.trace_fp);
+    }
+    if (itest_info.quiet_out) {
+        fclose(itest_info.quiet_out);
+    }
+    itest_perf_close();
     memset(&itest_info, 0, sizeof(itest_info));
-    itest_info.width = ITEST_DEFAULT_WIDTH;
-    itest_info.begin = itest_get_cpu_time();
-    itest_info.out   = stdout;
+    itest_info.width      = ITEST_DEFAULT_WIDTH;
+    itest_info.begin      = itest_get_cpu_time();
+    itest_info.wall_begin = itest_get_wall_time_ns();
+    itest_info.out        = stdout;
+    itest_info.jobs       = 1;
+    itest_info.profile_hz = ITEST_PROFILE_HZ;
     itest_set_flag(ITEST_FLAG_RECORD_TIMING);
 }
 
@@ -933,6 +6150,7 @@ itest_print_report(void)
     }
 
     update_counts_and_reset_suite();
+    itest_flush_inline_assertions();
     itest_info.end = itest_get_cpu_time();
     fprintf(itest_info.out, "\nTotal: %u test%s", itest_info.tests_run,
             itest_info.tests_run == 1 ? "" : "s");
@@ -941,6 +6159,22 @@ itest_print_report(void)
             itest_info.assertions == 1 ? "" : "s");
     fprintf(itest_info.out, "Pass: %u, fail: %u, skip: %u.\n",
             itest_info.passed, itest_info.failed, itest_info.skipped);
+    if (itest_info.golden_updated) {
+        fprintf(itest_info.out, "Updated %u golden file%s.\n",
+                itest_info.golden_updated,
+                itest_info.golden_updated == 1 ? "" : "s");
+    }
+    if (itest_info.rand_used) {
+        fprintf(itest_info.out, "Random streams seeded by --seed 0x%llx.\n",
+                itest_info.seed);
+    }
+    if (itest_get_flag(ITEST_FLAG_RUSAGE)) {
+        itest_report_usage_summary();
+    }
+    if (itest_info.sites != NULL) {
+        itest_report_sites_summary();
+    }
+    itest_trace_close();
 
     return itest_all_passed() ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -60,6 +60,38 @@ extern "C" {
 #    define ITEST_PRINTFLIKE(x, y) /* nothing */
 #endif
 
+/* Declaring a function that is rarely called, such as a failure path,
+   so that calls to it are kept out of the way of the hot path (if we
+   can), and testing a condition that is expected to be true.  */
+#if defined __GNUC__ && __GNUC__ >= 4
+#    define ITEST_COLD      __attribute__((__cold__, __noinline__))
+#    define ITEST_LIKELY(x) __builtin_expect(!!(x), 1)
+#else
+#    define ITEST_COLD      /* nothing */
+#    define ITEST_LIKELY(x) (x)
+#endif
+
+/* Thread-local storage (if we can) */
+#if defined __GNUC__ && __GNUC__ >= 3
+#    define ITEST_THREAD_LOCAL __thread
+#elif defined __cplusplus && __cplusplus >= 201103L
+#    define ITEST_THREAD_LOCAL thread_local
+#elif defined __STDC_VERSION__ && __STDC_VERSION__ >= 201112L
+#    define ITEST_THREAD_LOCAL _Thread_local
+#else
+#    define ITEST_THREAD_LOCAL /* nothing */
+#endif
+
+/* Define ITEST_INLINE_ASSERTS to 1, when compiling tests, to make
+   ITEST_ASSERT, ITEST_ASSERT_FALSE, and the relational assertions
+   (ITEST_ASSERT_EQ etc.) cost no more than a compare and a counter
+   increment when they succeed; only a failure calls into itest.c.
+   This has no effect on how itest.c is compiled, and code compiled
+   both ways can be mixed in one program.  */
+#ifndef ITEST_INLINE_ASSERTS
+#    define ITEST_INLINE_ASSERTS 0
+#endif
+
 /*********
  * Types *
  *********/
@@ -97,12 +129,39 @@ typedef struct itest_type_info
     itest_fprintf_cb *print;
 } itest_type_info;
 
+/* How the elements of an array are compared and printed by the array
+ * assertions: as signed integers, unsigned integers, or floating-point
+ * numbers.  The size of each element is given separately. */
+typedef enum itest_elem_kind
+{
+    ITEST_ELEM_INT,
+    ITEST_ELEM_UINT,
+    ITEST_ELEM_FP
+} itest_elem_kind;
+
+/* The relation checked by ITEST_ASSERT_EQ, ITEST_ASSERT_NEQ, etc.:
+ * EXP == GOT, EXP != GOT, EXP > GOT, and so on. */
+typedef enum itest_cmp_op
+{
+    ITEST_CMP_EQ,
+    ITEST_CMP_NEQ,
+    ITEST_CMP_GT,
+    ITEST_CMP_GTE,
+    ITEST_CMP_LT,
+    ITEST_CMP_LTE
+} itest_cmp_op;
+
 typedef enum itest_flag_t
 {
     ITEST_FLAG_FIRST_FAIL    = 0x01,
     ITEST_FLAG_LIST_ONLY     = 0x02,
     ITEST_FLAG_ABORT_ON_FAIL = 0x04,
-    ITEST_FLAG_RECORD_TIMING = 0x08
+    ITEST_FLAG_RECORD_TIMING = 0x08,
+    ITEST_FLAG_PERF_COUNTERS = 0x10,
+    ITEST_FLAG_RUSAGE        = 0x20,
+    ITEST_FLAG_ASSERT_SITES  = 0x40,
+    ITEST_FLAG_UPDATE_GOLDEN = 0x80,
+    ITEST_FLAG_FORK          = 0x100
 } itest_flag_t;
 
 /* overall pass/fail/skip counts */
@@ -114,6 +173,123 @@ typedef struct itest_report_t
     unsigned int assertions;
 } itest_report_t;
 
+/* Environment passed to each call of a test run by
+ * ITEST_RUN_CONCURRENT. */
+typedef struct itest_concurrent_env
+{
+    unsigned int thread;     /* index of the calling thread */
+    unsigned int nthreads;   /* number of threads running the test */
+    unsigned long iteration; /* number of calls so far on this thread */
+} itest_concurrent_env;
+
+/* How to run a test with ITEST_RUN_SCALING. */
+typedef struct itest_scaling_spec
+{
+    const unsigned int *threads; /* thread counts to try, in order; */
+    size_t nthreads;             /* NULL means 1, 2, 4, ... up to #CPUs */
+    unsigned long iterations;    /* calls per thread, per thread count */
+    unsigned int check_at;       /* thread count to check; 0 means max */
+    double min_efficiency;       /* 0 means don't check */
+} itest_scaling_spec;
+
+/* How to run a test with ITEST_RUN_LATENCY.  Latency limits are in
+ * nanoseconds; 0 means no limit. */
+typedef struct itest_latency_spec
+{
+    unsigned long iterations;   /* number of calls */
+    unsigned long sample_every; /* time every Nth call; 0 means all */
+    unsigned long long max_p50;
+    unsigned long long max_p90;
+    unsigned long long max_p99;
+    unsigned long long max_p999;
+    unsigned long long max_max;
+    const char *dump_file; /* write the histogram here, if not NULL */
+} itest_latency_spec;
+
+/* Type for ITEST_RUN_TABLE's NAME_CB argument: return the name of
+ * TEST_CASE, one element of the table, to be appended to the name of
+ * the test.  The string must remain valid until the case has run.  */
+typedef const char *itest_case_name_cb(const void *test_case);
+
+/* One parameter of an ITEST_RUN_PAIRWISE test: its NAME, and the names
+ * of its COUNT values.  VALUES may be NULL to name them by index.  */
+typedef struct itest_axis
+{
+    const char *name;
+    const char *const *values;
+    unsigned int count;
+} itest_axis;
+
+/* State of a pseudorandom number generator (xoshiro256**), for
+ * generating inputs to properties.  See itest_rand_seed.  A test's own
+ * stream, seeded from its name and the run seed (see --seed), so that
+ * it is the same however the tests are run, is itest_test_rand().  */
+typedef struct itest_rand
+{
+    unsigned long long s[4];
+} itest_rand;
+
+/* Results of an itest_prop_type's shrink callback. */
+typedef enum itest_shrink_res
+{
+    ITEST_SHRINK_OK,       /* SMALLER is a simpler input */
+    ITEST_SHRINK_DEAD_END, /* this tactic can't simplify VALUE */
+    ITEST_SHRINK_NO_MORE   /* TACTIC is past the last tactic */
+} itest_shrink_res;
+
+/* The input of a property tested with ITEST_RUN_PROPERTY.  A value is
+ * SIZE bytes, copied as such, so it can't own memory outside itself.  */
+typedef struct itest_prop_type
+{
+    size_t size;
+    /* Fill in VALUE at random, using RAND. */
+    void (*generate)(void *value, itest_rand *rand);
+    /* Write to SMALLER a simpler value than VALUE, using tactic TACTIC,
+     * numbered from 0, and return an itest_shrink_res.  May be NULL. */
+    int (*shrink)(const void *value, void *smaller, unsigned int tactic);
+    /* Print VALUE, to report a counterexample.  May be NULL. */
+    void (*print)(FILE *out, const void *value);
+} itest_prop_type;
+
+/* How to run a property with ITEST_RUN_PROPERTY.  Zero fields get the
+ * defaults noted.  */
+typedef struct itest_prop_spec
+{
+    unsigned long trials;      /* inputs to try; ITEST_PROP_TRIALS */
+    unsigned long long seed;   /* one derived from the test name */
+    unsigned int nthreads;     /* threads to try them on; -j */
+    unsigned long max_shrinks; /* ITEST_PROP_SHRINKS */
+} itest_prop_spec;
+
+/* Built-in input types: ints and unsigned ints, favoring small and
+ * extreme values, and shrinking towards zero.  */
+extern const itest_prop_type itest_prop_int;
+extern const itest_prop_type itest_prop_uint;
+
+/* Input of a fuzz target: see ITEST_FUZZ_TARGET and ITEST_RUN_CORPUS. */
+typedef struct itest_fuzz_input
+{
+    const unsigned char *data;
+    size_t size;
+} itest_fuzz_input;
+
+/* Layouts of the records in a test-vector file: see ITEST_RUN_VECTORS. */
+typedef enum itest_vector_format
+{
+    ITEST_VECTORS_LINES,   /* one per line, without its newline */
+    ITEST_VECTORS_LEN32BE, /* each after its length, as 4 big-endian bytes */
+} itest_vector_format;
+
+/* A record of a test-vector file, as passed to the test: a view of the
+ * file, which is only mapped while the tests run, and the record's
+ * offset in it.  */
+typedef struct itest_record
+{
+    const unsigned char *data;
+    size_t size;
+    size_t offset;
+} itest_record;
+
 /* Type for ASSERT_ENUM_EQ's ENUM_STR argument. */
 typedef const char *itest_enum_str_fun(int value);
 
@@ -127,9 +303,47 @@ void itest_test_post(int res);
 
 void itest_assert(const char *msg, const char *file, unsigned int line,
                   int cond);
+ITEST_NORETURN itest_assert_failed(const char *msg, const char *file,
+                                   unsigned int line) ITEST_COLD;
+ITEST_NORETURN itest_assert_failedf(const char *file, unsigned int line,
+                                    const char *fmt, ...) ITEST_COLD
+    ITEST_PRINTFLIKE(3, 4);
+extern ITEST_THREAD_LOCAL unsigned long itest_inline_assertions;
 void itest_assert_eq_fmt(const char *msg, const char *file, unsigned int line,
                          const char *fmt, int cond, ...)
     ITEST_PRINTFLIKE(4, 6);
+void itest_assert_cmp_int(const char *msg, const char *file,
+                          unsigned int line, itest_cmp_op op,
+                          const char *fmt, int exp, int got);
+void itest_assert_cmp_uint(const char *msg, const char *file,
+                           unsigned int line, itest_cmp_op op,
+                           const char *fmt, unsigned int exp,
+                           unsigned int got);
+void itest_assert_cmp_long(const char *msg, const char *file,
+                           unsigned int line, itest_cmp_op op,
+                           const char *fmt, long exp, long got);
+void itest_assert_cmp_ulong(const char *msg, const char *file,
+                            unsigned int line, itest_cmp_op op,
+                            const char *fmt, unsigned long exp,
+                            unsigned long got);
+void itest_assert_cmp_llong(const char *msg, const char *file,
+                            unsigned int line, itest_cmp_op op,
+                            const char *fmt, long long exp, long long got);
+void itest_assert_cmp_ullong(const char *msg, const char *file,
+                             unsigned int line, itest_cmp_op op,
+                             const char *fmt, unsigned long long exp,
+                             unsigned long long got);
+void itest_assert_cmp_double(const char *msg, const char *file,
+                             unsigned int line, itest_cmp_op op,
+                             const char *fmt, double exp, double got);
+void itest_assert_cmp_ldouble(const char *msg, const char *file,
+                              unsigned int line, itest_cmp_op op,
+                              const char *fmt, long double exp,
+                              long double got);
+void itest_assert_cmp_ptr(const char *msg, const char *file,
+                          unsigned int line, itest_cmp_op op,
+                          const char *fmt, const void *exp,
+                          const void *got);
 void itest_assert_eq_enum(const char *msg, const char *file,
                           unsigned int line, itest_enum_str_fun enum_str,
                           int exp, int got);
@@ -145,9 +359,43 @@ void itest_assert_equal_strn(const char *msg, const char *file,
 void itest_assert_equal_mem(const char *msg, const char *file,
                             unsigned int line, const void *exp,
                             const void *got, size_t size);
+void itest_assert_golden(const char *msg, const char *file, unsigned int line,
+                         const char *path, const void *got, size_t size);
+void itest_assert_golden_file(const char *msg, const char *file,
+                              unsigned int line, const char *path,
+                              const char *got_path);
 void itest_assert_equal_t(const char *msg, const char *file,
                           unsigned int line, const void *exp, const void *got,
                           const itest_type_info *type_info, void *udata);
+void itest_assert_array_eq(const char *msg, const char *file,
+                           unsigned int line, itest_elem_kind kind,
+                           const void *exp, const void *got, size_t count,
+                           size_t size);
+void itest_assert_all_eq(const char *msg, const char *file, unsigned int line,
+                         itest_elem_kind kind, unsigned long long exp,
+                         const void *got, size_t count, size_t size);
+void itest_assert_all_eq_fp(const char *msg, const char *file,
+                            unsigned int line, double exp, const void *got,
+                            size_t count, size_t size);
+void itest_assert_within_ulps(const char *msg, const char *file,
+                              unsigned int line, double exp, double got,
+                              unsigned long ulps, size_t size);
+void itest_assert_within_rel(const char *msg, const char *file,
+                             unsigned int line, double exp, double got,
+                             double tol, size_t size);
+void itest_assert_array_within_ulps(const char *msg, const char *file,
+                                    unsigned int line, const void *exp,
+                                    const void *got, size_t count,
+                                    size_t size, unsigned long ulps);
+void itest_assert_array_within_rel(const char *msg, const char *file,
+                                   unsigned int line, const void *exp,
+                                   const void *got, size_t count,
+                                   size_t size, double tol);
+void itest_assert_array_equal_t(const char *msg, const char *file,
+                                unsigned int line, const void *exp,
+                                const void *got, size_t count, size_t size,
+                                const itest_type_info *type_info,
+                                void *udata);
 
 void itest_shuffle_init(unsigned int id, unsigned long seed);
 void itest_shuffle_next(unsigned int id);
@@ -156,6 +404,8 @@ int itest_shuffle_running(unsigned int id);
 /* These are part of the public itest API. */
 void itest_set_setup_cb(itest_setup_cb *cb, void *udata);
 void itest_set_teardown_cb(itest_teardown_cb *cb, void *udata);
+void itest_set_suite_fixture(itest_setup_cb *setup,
+                             itest_teardown_cb *teardown, void *udata);
 void itest_set_output(FILE *fp);
 void itest_init(void);
 void itest_parse_options(int argc, char **argv);
@@ -165,6 +415,57 @@ void itest_run_suite(itest_suite_cb *suite_cb, const char *suite_name);
 void itest_run_test(itest_test_cb *test_cb, const char *test_name);
 void itest_run_test_with_env(itest_test_env_cb *test_cb,
                              const char *test_name, void *env);
+void itest_run_suite_parallel(itest_suite_cb *suite_cb,
+                              const char *suite_name);
+void itest_run_test_parallel(itest_test_cb *test_cb, const char *test_name);
+void itest_run_test_with_env_parallel(itest_test_env_cb *test_cb,
+                                      const char *test_name, void *env);
+void itest_join_parallel(void);
+void itest_run_table(itest_test_env_cb *test_cb, const char *test_name,
+                     const void *cases, size_t size, size_t count,
+                     itest_case_name_cb *name_cb);
+void itest_run_table_parallel(itest_test_env_cb *test_cb,
+                              const char *test_name, const void *cases,
+                              size_t size, size_t count,
+                              itest_case_name_cb *name_cb);
+void itest_run_combinations(itest_test_env_cb *test_cb,
+                            const char *test_name, const itest_axis *axes,
+                            unsigned int naxes, unsigned int strength);
+void itest_run_concurrent(itest_test_env_cb *test_cb, const char *test_name,
+                          unsigned int nthreads, unsigned long iterations);
+void itest_run_scaling(itest_test_env_cb *test_cb, const char *test_name,
+                       const itest_scaling_spec *spec, const char *file,
+                       unsigned int line);
+void itest_run_latency(itest_test_env_cb *test_cb, const char *test_name,
+                       const itest_latency_spec *spec, const char *file,
+                       unsigned int line);
+void itest_run_bench(itest_test_env_cb *test_cb, const char *test_name,
+                     unsigned long iterations);
+void itest_run_property(itest_test_env_cb *test_cb, const char *test_name,
+                        const itest_prop_type *type,
+                        const itest_prop_spec *spec);
+void itest_set_prop_seed(unsigned long long seed);
+int itest_fuzz_one(itest_test_env_cb *test_cb, const char *test_name,
+                   const unsigned char *data, size_t size);
+void itest_run_corpus(itest_test_env_cb *test_cb, const char *test_name,
+                      const char *dir);
+void itest_run_corpus_parallel(itest_test_env_cb *test_cb,
+                               const char *test_name, const char *dir);
+void itest_run_vectors(itest_test_env_cb *test_cb, const char *test_name,
+                       const char *path, itest_vector_format format);
+void itest_run_vectors_parallel(itest_test_env_cb *test_cb,
+                                const char *test_name, const char *path,
+                                itest_vector_format format);
+itest_rand *itest_test_rand(void);
+void itest_set_seed(unsigned long long seed);
+void itest_rand_seed(itest_rand *rand, unsigned long long seed);
+unsigned long long itest_rand_u64(itest_rand *rand);
+unsigned long long itest_rand_below(itest_rand *rand, unsigned long long n);
+double itest_rand_double(itest_rand *rand);
+void itest_set_jobs(unsigned int n);
+void itest_set_profile(const char *dir, unsigned int hz);
+void itest_set_trace(const char *path);
+unsigned int itest_get_jobs(void);
 void itest_set_suite_filter(const char *filter);
 void itest_set_test_filter(const char *filter);
 void itest_set_test_exclude(const char *filter);
@@ -184,6 +485,13 @@ ITEST_NORETURN itest_fail(const char *msg, const char *file,
                           unsigned int line);
 ITEST_NORETURN itest_skip(const char *msg, const char *file,
                           unsigned int line);
+ITEST_NORETURN itest_failf(const char *file, unsigned int line,
+                           const char *fmt, ...) ITEST_PRINTFLIKE(3, 4);
+ITEST_NORETURN itest_skipf(const char *file, unsigned int line,
+                           const char *fmt, ...) ITEST_PRINTFLIKE(3, 4);
+void itest_check_threads(void);
+void *itest_current_test(void);
+void itest_adopt_test(void *test);
 
 /**********
  * Macros *
@@ -212,6 +520,157 @@ ITEST_NORETURN itest_skip(const char *msg, const char *file,
    which is a `void *`.  */
 #define ITEST_RUN_TEST1(TEST, ENV) itest_run_test_with_env(TEST, #TEST, ENV)
 
+/* Parallel-safe tests.  When the runner is using more than one thread
+ * (see itest_set_jobs and the -j option), these tests are queued, and
+ * run on a thread pool when the suite ends, when a test that isn't
+ * parallel-safe is run, or at ITEST_JOIN_PARALLEL().  Their results are
+ * reported in the order they were queued.  A parallel-safe test must
+ * not depend on other tests or print output, and helper threads it
+ * starts must adopt it (see ITEST_ADOPT_TEST); its setup and teardown
+ * hooks run on the same thread as the test.  ENV must remain valid
+ * until the test has been run.  The pool's threads are started for
+ * each batch of queued tests and joined when it is done.
+ *
+ * ITEST_RUN_SUITE_PARALLEL treats every test in the suite as
+ * parallel-safe.  */
+#define ITEST_RUN_SUITE_PARALLEL(S_NAME)                                     \
+    itest_run_suite_parallel(S_NAME, #S_NAME)
+#define ITEST_RUN_TEST_PARALLEL(TEST) itest_run_test_parallel(TEST, #TEST)
+#define ITEST_RUN_TEST1_PARALLEL(TEST, ENV)                                  \
+    itest_run_test_with_env_parallel(TEST, #TEST, ENV)
+#define ITEST_JOIN_PARALLEL() itest_join_parallel()
+
+/* Table-driven tests: run test function TEST once for each of the COUNT
+ * elements of the array CASES, passing a pointer to the element as its
+ * `void *` argument.  Each case is a separate test, named TEST, an
+ * underscore, and the string NAME_CB returns for the case, or its
+ * index if NAME_CB is NULL.  NAME_CB is only called for cases that are
+ * run, or that a name filter needs to see, so skipping through a long
+ * table (with -t, or when shuffling) costs little.  */
+#define ITEST_RUN_TABLE(TEST, CASES, COUNT, NAME_CB)                         \
+    itest_run_table(TEST, #TEST, CASES, sizeof *(CASES), COUNT, NAME_CB)
+#define ITEST_RUN_TABLE_PARALLEL(TEST, CASES, COUNT, NAME_CB)                \
+    itest_run_table_parallel(TEST, #TEST, CASES, sizeof *(CASES), COUNT,     \
+                             NAME_CB)
+
+/* Combinatorial tests: run test function TEST on combinations of values
+ * of the NAXES parameters described by the array AXES, passing it an
+ * `unsigned int *` holding the index of each parameter's value.  Rather
+ * than every combination, only enough are run to cover every pair of
+ * values of any two parameters (or, with ITEST_RUN_COMBINATIONS, every
+ * STRENGTH-tuple of values of any STRENGTH parameters); a STRENGTH of
+ * NAXES runs them all.  The combinations are chosen greedily as the
+ * tests run.  Each is a separate test, named TEST, an underscore, and
+ * `name=value` for each parameter, separated by commas.  */
+#define ITEST_RUN_PAIRWISE(TEST, AXES, NAXES)                                \
+    itest_run_combinations(TEST, #TEST, AXES, NAXES, 2)
+#define ITEST_RUN_COMBINATIONS(TEST, AXES, NAXES, STRENGTH)                  \
+    itest_run_combinations(TEST, #TEST, AXES, NAXES, STRENGTH)
+
+/* Stress test: run test function TEST on NTHREADS threads at once,
+ * calling it ITERATIONS times on each thread.  The threads are all
+ * started before any of them calls TEST.  TEST receives a pointer to an
+ * itest_concurrent_env, giving the index of the calling thread.  If any
+ * call fails, the other threads stop after their current call, and the
+ * failing thread and iteration are reported.  In verbose mode, the
+ * throughput of each thread and of all threads is also reported.  */
+#define ITEST_RUN_CONCURRENT(TEST, NTHREADS, ITERATIONS)                     \
+    itest_run_concurrent(TEST, #TEST, NTHREADS, ITERATIONS)
+
+/* Scaling benchmark: run test function TEST as ITEST_RUN_CONCURRENT
+ * does, once per thread count listed in *SPEC (an itest_scaling_spec).
+ * In verbose mode, report throughput, speedup, and parallel efficiency
+ * at each thread count, relative to the first.  If SPEC->min_efficiency
+ * is set, fail when efficiency at SPEC->check_at threads is lower, or
+ * can't be worked out: no thread count in SPEC is SPEC->check_at, or the
+ * first one has no throughput.  */
+#define ITEST_RUN_SCALING(TEST, SPEC)                                        \
+    itest_run_scaling(TEST, #TEST, SPEC, __FILE__, __LINE__)
+
+/* Latency benchmark: call test function TEST SPEC->iterations times on
+ * this thread, timing each call (or every SPEC->sample_every'th call)
+ * into a log-linear histogram.  TEST receives a pointer to an
+ * itest_concurrent_env, as for ITEST_RUN_CONCURRENT.  In verbose mode,
+ * report the 50th, 90th, 99th, and 99.9th percentile and the maximum
+ * latency.  Fail if any of these exceeds its limit in *SPEC.  If
+ * SPEC->dump_file is set, write the histogram there for plotting. */
+#define ITEST_RUN_LATENCY(TEST, SPEC)                                        \
+    itest_run_latency(TEST, #TEST, SPEC, __FILE__, __LINE__)
+
+/* Benchmark: call test function TEST ITERATIONS times on this thread.
+ * TEST receives a pointer to an itest_concurrent_env.  When the program
+ * is run under `valgrind --tool=callgrind`, only those calls are
+ * counted, and the counts (instructions, plus cache misses and branch
+ * mispredicts if enabled) are dumped, labelled with the test name, for
+ * callgrind_annotate to read.  Otherwise, in verbose mode, the mean
+ * wall-clock time per call is reported.  */
+#define ITEST_RUN_BENCH(TEST, ITERATIONS)                                    \
+    itest_run_bench(TEST, #TEST, ITERATIONS)
+
+/* Property-based test: call test function TEST on SPEC->trials random
+ * inputs of itest_prop_type *TYPE, spread over SPEC->nthreads threads.
+ * SPEC may be NULL for the defaults.  TEST receives a pointer to the
+ * input, and checks it with assertions; it can SKIP to discard an
+ * input.  If any input fails, the first to fail (by trial number, so
+ * the same one however the threads are scheduled) is shrunk, as long as
+ * TYPE->shrink gives simpler inputs that still fail.  The simplest
+ * counterexample and the seed to replay its trial with --prop-seed are
+ * printed, and TEST is run on it once more to report its failure.  */
+#define ITEST_RUN_PROPERTY(TEST, TYPE, SPEC)                                 \
+    itest_run_property(TEST, #TEST, TYPE, SPEC)
+
+/* Fuzz target: when compiled with ITEST_FUZZING defined, define the
+ * libFuzzer entry point LLVMFuzzerTestOneInput to call test function
+ * TEST with an itest_fuzz_input holding each input.  A failure in TEST
+ * is printed and aborts the program, for the fuzzer to catch; a SKIP
+ * keeps the input out of the corpus.  Build with, for instance,
+ * `clang -fsanitize=fuzzer -DITEST_FUZZING` (AFL++ can use the same
+ * entry point), and leave out the program's own main.  Otherwise this
+ * only declares the entry point.  Use at file scope, once per program,
+ * followed by a semicolon.  */
+#ifdef __cplusplus
+#    define ITEST__FUZZ_LINKAGE extern "C"
+#else
+#    define ITEST__FUZZ_LINKAGE
+#endif
+#ifdef ITEST_FUZZING
+#    define ITEST_FUZZ_TARGET(TEST)                                          \
+        ITEST__FUZZ_LINKAGE int LLVMFuzzerTestOneInput(                      \
+            const unsigned char *data, size_t size);                         \
+        ITEST__FUZZ_LINKAGE int LLVMFuzzerTestOneInput(                      \
+            const unsigned char *data, size_t size)                          \
+        {                                                                    \
+            return itest_fuzz_one(TEST, #TEST, data, size);                  \
+        }                                                                    \
+        ITEST__FUZZ_LINKAGE int LLVMFuzzerTestOneInput(                      \
+            const unsigned char *data, size_t size)
+#else
+#    define ITEST_FUZZ_TARGET(TEST)                                          \
+        ITEST__FUZZ_LINKAGE int LLVMFuzzerTestOneInput(                      \
+            const unsigned char *data, size_t size)
+#endif
+
+/* Corpus replay: run test function TEST once for each regular file in
+ * directory DIR (except hidden ones), in order of name, passing it an
+ * itest_fuzz_input holding the file's contents, which are mapped into
+ * memory rather than read.  Each file is a separate test, named TEST,
+ * an underscore, and the file's name.  This is how a fuzz target's
+ * corpus is checked in ordinary test runs.  */
+#define ITEST_RUN_CORPUS(TEST, DIR) itest_run_corpus(TEST, #TEST, DIR)
+#define ITEST_RUN_CORPUS_PARALLEL(TEST, DIR)                                 \
+    itest_run_corpus_parallel(TEST, #TEST, DIR)
+
+/* Run TEST once for each record in the test-vector file at PATH, laid
+ * out as FORMAT (an itest_vector_format) says, passing it an
+ * itest_record.  The file is mapped into memory, not read, and records
+ * are views of it, so files can be larger than memory.  Each record is
+ * reported as a test named by appending an underscore and the record's
+ * offset in the file, so `-e -t TEST_OFFSET` reruns just that one.  */
+#define ITEST_RUN_VECTORS(TEST, PATH, FORMAT)                                \
+    itest_run_vectors(TEST, #TEST, PATH, FORMAT)
+#define ITEST_RUN_VECTORS_PARALLEL(TEST, PATH, FORMAT)                       \
+    itest_run_vectors_parallel(TEST, #TEST, PATH, FORMAT)
+
 /* Ignore test function TEST, don't warn about it being unused. */
 #define ITEST_IGNORE_TEST(TEST) (void)TEST
 
@@ -231,6 +690,16 @@ ITEST_NORETURN itest_skip(const char *msg, const char *file,
     ITEST_ASSERT_LTEm(#EXP " > " #GOT, EXP, GOT)
 #define ITEST_ASSERT_EQ_FMT(EXP, GOT, FMT)                                   \
     ITEST_ASSERT_EQ_FMTm(#EXP " != " #GOT, EXP, GOT, FMT)
+#define ITEST_ASSERT_NEQ_FMT(EXP, GOT, FMT)                                  \
+    ITEST_ASSERT_NEQ_FMTm(#EXP " == " #GOT, EXP, GOT, FMT)
+#define ITEST_ASSERT_GT_FMT(EXP, GOT, FMT)                                   \
+    ITEST_ASSERT_GT_FMTm(#EXP " <= " #GOT, EXP, GOT, FMT)
+#define ITEST_ASSERT_GTE_FMT(EXP, GOT, FMT)                                  \
+    ITEST_ASSERT_GTE_FMTm(#EXP " < " #GOT, EXP, GOT, FMT)
+#define ITEST_ASSERT_LT_FMT(EXP, GOT, FMT)                                   \
+    ITEST_ASSERT_LT_FMTm(#EXP " >= " #GOT, EXP, GOT, FMT)
+#define ITEST_ASSERT_LTE_FMT(EXP, GOT, FMT)                                  \
+    ITEST_ASSERT_LTE_FMTm(#EXP " > " #GOT, EXP, GOT, FMT)
 #define ITEST_ASSERT_IN_RANGE(EXP, GOT, TOL)                                 \
     ITEST_ASSERT_IN_RANGEm(#EXP " != " #GOT " +/- " #TOL, EXP, GOT, TOL)
 #define ITEST_ASSERT_EQUAL_T(EXP, GOT, TYPE_INFO, UDATA)                     \
@@ -241,46 +710,248 @@ ITEST_NORETURN itest_skip(const char *msg, const char *file,
     ITEST_ASSERT_STRN_EQm(#EXP " != " #GOT, EXP, GOT, SIZE)
 #define ITEST_ASSERT_MEM_EQ(EXP, GOT, SIZE)                                  \
     ITEST_ASSERT_MEM_EQm(#EXP " != " #GOT, EXP, GOT, SIZE)
+#define ITEST_ASSERT_MATCHES_GOLDEN(PATH, GOT, SIZE)                         \
+    ITEST_ASSERT_MATCHES_GOLDENm(#GOT " != golden " #PATH, PATH, GOT, SIZE)
+#define ITEST_ASSERT_FILE_MATCHES_GOLDEN(PATH, GOT_PATH)                     \
+    ITEST_ASSERT_FILE_MATCHES_GOLDENm(#GOT_PATH " != golden " #PATH, PATH,   \
+                                      GOT_PATH)
 #define ITEST_ASSERT_ENUM_EQ(EXP, GOT, ENUM_STR)                             \
     ITEST_ASSERT_ENUM_EQm(#EXP " != " #GOT, EXP, GOT, ENUM_STR)
+#define ITEST_ASSERT_INT_ARRAY_EQ(EXP, GOT, COUNT)                           \
+    ITEST_ASSERT_INT_ARRAY_EQm(#EXP " != " #GOT, EXP, GOT, COUNT)
+#define ITEST_ASSERT_UINT_ARRAY_EQ(EXP, GOT, COUNT)                          \
+    ITEST_ASSERT_UINT_ARRAY_EQm(#EXP " != " #GOT, EXP, GOT, COUNT)
+#define ITEST_ASSERT_FP_ARRAY_EQ(EXP, GOT, COUNT)                            \
+    ITEST_ASSERT_FP_ARRAY_EQm(#EXP " != " #GOT, EXP, GOT, COUNT)
+#define ITEST_ASSERT_ARRAY_EQUAL_T(EXP, GOT, COUNT, TYPE_INFO, UDATA)        \
+    ITEST_ASSERT_ARRAY_EQUAL_Tm(#EXP " != " #GOT, EXP, GOT, COUNT,          \
+                                TYPE_INFO, UDATA)
+#define ITEST_ASSERT_WITHIN_ULPS(EXP, GOT, ULPS)                             \
+    ITEST_ASSERT_WITHIN_ULPSm(#EXP " != " #GOT " +/- " #ULPS " ulps", EXP,  \
+                              GOT, ULPS)
+#define ITEST_ASSERT_WITHIN_REL(EXP, GOT, TOL)                               \
+    ITEST_ASSERT_WITHIN_RELm(#EXP " != " #GOT " +/- " #TOL " relative", EXP, \
+                             GOT, TOL)
+#define ITEST_ASSERT_ARRAY_WITHIN_ULPS(EXP, GOT, COUNT, ULPS)                \
+    ITEST_ASSERT_ARRAY_WITHIN_ULPSm(#EXP " != " #GOT " +/- " #ULPS " ulps",  \
+                                    EXP, GOT, COUNT, ULPS)
+#define ITEST_ASSERT_ARRAY_WITHIN_REL(EXP, GOT, COUNT, TOL)                  \
+    ITEST_ASSERT_ARRAY_WITHIN_RELm(#EXP " != " #GOT " +/- " #TOL             \
+                                   " relative",                              \
+                                   EXP, GOT, COUNT, TOL)
+#define ITEST_ASSERT_INT_ALL_EQ(EXP, GOT, COUNT)                             \
+    ITEST_ASSERT_INT_ALL_EQm(#EXP " != " #GOT, EXP, GOT, COUNT)
+#define ITEST_ASSERT_UINT_ALL_EQ(EXP, GOT, COUNT)                            \
+    ITEST_ASSERT_UINT_ALL_EQm(#EXP " != " #GOT, EXP, GOT, COUNT)
+#define ITEST_ASSERT_FP_ALL_EQ(EXP, GOT, COUNT)                              \
+    ITEST_ASSERT_FP_ALL_EQm(#EXP " != " #GOT, EXP, GOT, COUNT)
 
 /* The following forms take an additional message argument first,
  * to be displayed by the test runner. */
 
+/* Internal macro for simple assertions: out of line, or inline with
+ * an out-of-line failure path if ITEST_INLINE_ASSERTS is set. */
+#if ITEST_INLINE_ASSERTS
+#    define ITEST__ASSERT(MSG, COND)                                         \
+        (ITEST_LIKELY(COND) ? (void)++itest_inline_assertions                \
+                            : itest_assert_failed(MSG, __FILE__, __LINE__))
+#else
+#    define ITEST__ASSERT(MSG, COND)                                         \
+        itest_assert(MSG, __FILE__, __LINE__, COND)
+#endif
+
 /* Fail if a condition is not true, with message. */
-#define ITEST_ASSERTm(MSG, COND) itest_assert(MSG, __FILE__, __LINE__, COND)
+#define ITEST_ASSERTm(MSG, COND) ITEST__ASSERT(MSG, COND)
 
 /* Fail if a condition is not false, with message. */
-#define ITEST_ASSERT_FALSEm(MSG, COND)                                       \
-    itest_assert(MSG, __FILE__, __LINE__, !(COND))
+#define ITEST_ASSERT_FALSEm(MSG, COND) ITEST__ASSERT(MSG, !(COND))
+
+/* As ITEST_ASSERTm and ITEST_ASSERT_FALSEm, but with a printf-style
+ * message, which is only formatted (and its arguments only evaluated)
+ * if the assertion fails.  See ITEST_MESSAGE_BUF_SIZE in itest.c for
+ * the longest message kept.  */
+#if ITEST_INLINE_ASSERTS
+#    define ITEST__PASSED() (void)++itest_inline_assertions
+#else
+#    define ITEST__PASSED() itest_assert(NULL, __FILE__, __LINE__, 1)
+#endif
+#define ITEST_ASSERTf(COND, ...)                                             \
+    (ITEST_LIKELY(COND) ? ITEST__PASSED()                                    \
+                        : itest_assert_failedf(__FILE__, __LINE__,           \
+                                               __VA_ARGS__))
+#define ITEST_ASSERT_FALSEf(COND, ...) ITEST_ASSERTf(!(COND), __VA_ARGS__)
 
-/* Internal macro for relational assertions */
-#define ITEST__REL(REL, MSG, EXP, GOT)                                       \
-    itest_assert(MSG, __FILE__, __LINE__, ((EXP)REL(GOT)))
+/* Internal macro for relational assertions.  Where the language
+ * allows, each operand is evaluated exactly once, compared as the
+ * type that the comparison operator itself would use, and printed
+ * with FMT (or a format inferred from that type, if FMT is NULL) on
+ * failure.  With ITEST_INLINE_ASSERTS, the comparison is done inline
+ * and the operands are not printed. */
+#if defined __cplusplus && __cplusplus >= 201103L
+extern "C++" {
+template <typename T> struct itest__strip
+{
+    typedef T type;
+};
+template <typename T> struct itest__strip<const T>
+{
+    typedef T type;
+};
+template <typename T> struct itest__strip<T &> : itest__strip<T>
+{
+};
+
+/* Compare operands of a type that the library doesn't know how to
+ * print with their own operators. */
+template <itest_cmp_op OP> struct itest__rel;
+#    define ITEST__REL_OP(OP, REL)                                           \
+        template <> struct itest__rel<OP>                                    \
+        {                                                                    \
+            template <typename T> static bool test(const T &a, const T &b)   \
+            {                                                                \
+                return a REL b;                                              \
+            }                                                                \
+        }
+ITEST__REL_OP(ITEST_CMP_EQ, ==);
+ITEST__REL_OP(ITEST_CMP_NEQ, !=);
+ITEST__REL_OP(ITEST_CMP_GT, >);
+ITEST__REL_OP(ITEST_CMP_GTE, >=);
+ITEST__REL_OP(ITEST_CMP_LT, <);
+ITEST__REL_OP(ITEST_CMP_LTE, <=);
+#    undef ITEST__REL_OP
+
+template <typename T> struct itest__cmp_type
+{
+    template <itest_cmp_op OP>
+    static void cmp(const char *msg, const char *file, unsigned int line,
+                    const char *, const T &exp, const T &got)
+    {
+        itest_assert(msg, file, line, itest__rel<OP>::test(exp, got));
+    }
+};
+
+/* Compare and print all other operands out of line, as C does. */
+template <typename T, void (*F)(const char *, const char *, unsigned int,
+                                itest_cmp_op, const char *, T, T)>
+struct itest__cmp_fn
+{
+    template <itest_cmp_op OP>
+    static void cmp(const char *msg, const char *file, unsigned int line,
+                    const char *fmt, T exp, T got)
+    {
+        F(msg, file, line, OP, fmt, exp, got);
+    }
+};
+
+#    define ITEST__CMP_TYPE(T, U, F)                                         \
+        template <>                                                          \
+        struct itest__cmp_type<T> : itest__cmp_fn<U, F>                      \
+        {                                                                    \
+        }
+ITEST__CMP_TYPE(bool, int, itest_assert_cmp_int);
+ITEST__CMP_TYPE(char, int, itest_assert_cmp_int);
+ITEST__CMP_TYPE(signed char, int, itest_assert_cmp_int);
+ITEST__CMP_TYPE(unsigned char, int, itest_assert_cmp_int);
+ITEST__CMP_TYPE(short, int, itest_assert_cmp_int);
+ITEST__CMP_TYPE(unsigned short, int, itest_assert_cmp_int);
+ITEST__CMP_TYPE(int, int, itest_assert_cmp_int);
+ITEST__CMP_TYPE(unsigned int, unsigned int, itest_assert_cmp_uint);
+ITEST__CMP_TYPE(long, long, itest_assert_cmp_long);
+ITEST__CMP_TYPE(unsigned long, unsigned long, itest_assert_cmp_ulong);
+ITEST__CMP_TYPE(long long, long long, itest_assert_cmp_llong);
+ITEST__CMP_TYPE(unsigned long long, unsigned long long,
+                itest_assert_cmp_ullong);
+ITEST__CMP_TYPE(float, double, itest_assert_cmp_double);
+ITEST__CMP_TYPE(double, double, itest_assert_cmp_double);
+ITEST__CMP_TYPE(long double, long double, itest_assert_cmp_ldouble);
+#    undef ITEST__CMP_TYPE
+template <typename T>
+struct itest__cmp_type<T *>
+    : itest__cmp_fn<const void *, itest_assert_cmp_ptr>
+{
+};
+} /* extern "C++" */
+
+#    define ITEST__CMP(OP, MSG, FMT, EXP, GOT)                               \
+        itest__cmp_type<typename itest__strip<decltype(                      \
+            true ? (EXP) : (GOT))>::type>::template cmp<ITEST_CMP_##OP>(     \
+            MSG, __FILE__, __LINE__, FMT, EXP, GOT)
+#elif defined __STDC_VERSION__ && __STDC_VERSION__ >= 201112L
+#    define ITEST__CMP(OP, MSG, FMT, EXP, GOT)                               \
+        _Generic(1 ? (EXP) : (GOT),                                          \
+            int: itest_assert_cmp_int,                                       \
+            unsigned int: itest_assert_cmp_uint,                             \
+            long: itest_assert_cmp_long,                                     \
+            unsigned long: itest_assert_cmp_ulong,                           \
+            long long: itest_assert_cmp_llong,                               \
+            unsigned long long: itest_assert_cmp_ullong,                     \
+            float: itest_assert_cmp_double,                                  \
+            double: itest_assert_cmp_double,                                 \
+            long double: itest_assert_cmp_ldouble,                           \
+            default: itest_assert_cmp_ptr)(MSG, __FILE__, __LINE__,          \
+                                           ITEST_CMP_##OP, FMT, EXP, GOT)
+#endif
+#if ITEST_INLINE_ASSERTS
+#    define ITEST__REL(OP, REL, MSG, EXP, GOT)                               \
+        ITEST__ASSERT(MSG, ((EXP)REL(GOT)))
+#elif defined ITEST__CMP
+#    define ITEST__REL(OP, REL, MSG, EXP, GOT)                               \
+        ITEST__CMP(OP, MSG, NULL, EXP, GOT)
+#else
+#    define ITEST__REL(OP, REL, MSG, EXP, GOT)                               \
+        itest_assert(MSG, __FILE__, __LINE__, (EXP)REL(GOT))
+#endif
+#ifdef ITEST__CMP
+/* The call to itest_assert_eq_fmt is never made, and evaluates nothing;
+ * it is there so that the compiler checks FMT against EXP and GOT. */
+#    define ITEST__REL_FMT(OP, REL, MSG, FMT, EXP, GOT)                      \
+        (ITEST__CMP(OP, MSG, FMT, EXP, GOT),                                 \
+         (void)(0                                                            \
+                && (itest_assert_eq_fmt(MSG, __FILE__, __LINE__,             \
+                                        "\nExpected: " FMT                   \
+                                        "\n     Got: " FMT "\n",             \
+                                        0, EXP, GOT),                        \
+                    0)))
+#else
+/* Before C11, EXP and GOT are evaluated twice each on failure. */
+#    define ITEST__REL_FMT(OP, REL, MSG, FMT, EXP, GOT)                      \
+        itest_assert_eq_fmt(MSG, __FILE__, __LINE__,                         \
+                            "\nExpected: " FMT "\n     Got: " FMT "\n",      \
+                            (EXP)REL(GOT), EXP, GOT)
+#endif
 
 /* Fail if EXP is not ==, !=, >, <, >=, or <= to GOT. */
-#define ITEST_ASSERT_EQm(MSG, E, G)  ITEST__REL(==, MSG, E, G)
-#define ITEST_ASSERT_NEQm(MSG, E, G) ITEST__REL(!=, MSG, E, G)
-#define ITEST_ASSERT_GTm(MSG, E, G)  ITEST__REL(>, MSG, E, G)
-#define ITEST_ASSERT_GTEm(MSG, E, G) ITEST__REL(>=, MSG, E, G)
-#define ITEST_ASSERT_LTm(MSG, E, G)  ITEST__REL(<, MSG, E, G)
-#define ITEST_ASSERT_LTEm(MSG, E, G) ITEST__REL(<=, MSG, E, G)
-
-/* Fail if EXP != GOT (equality comparison by ==).  FMT must be a
+#define ITEST_ASSERT_EQm(MSG, E, G)  ITEST__REL(EQ, ==, MSG, E, G)
+#define ITEST_ASSERT_NEQm(MSG, E, G) ITEST__REL(NEQ, !=, MSG, E, G)
+#define ITEST_ASSERT_GTm(MSG, E, G)  ITEST__REL(GT, >, MSG, E, G)
+#define ITEST_ASSERT_GTEm(MSG, E, G) ITEST__REL(GTE, >=, MSG, E, G)
+#define ITEST_ASSERT_LTm(MSG, E, G)  ITEST__REL(LT, <, MSG, E, G)
+#define ITEST_ASSERT_LTEm(MSG, E, G) ITEST__REL(LTE, <=, MSG, E, G)
+
+/* As above, printing EXP and GOT with FMT on failure.  FMT must be a
  * string literal containing a single printf format specifier which
- * agrees with  the type of both EXP and GOT.
- * Warning: EXP and GOT will be evaluated exactly twice each.  */
-#define ITEST_ASSERT_EQ_FMTm(MSG, EXP, GOT, FMT)                             \
-    itest_assert_eq_fmt(MSG, __FILE__, __LINE__,                             \
-                        "\nExpected: " FMT "\n     Got: " FMT "\n",          \
-                        (GOT) == (EXP), EXP, GOT);
+ * agrees with the type of both EXP and GOT, after the usual
+ * arithmetic conversions.  */
+#define ITEST_ASSERT_EQ_FMTm(MSG, E, G, FMT)                                 \
+    ITEST__REL_FMT(EQ, ==, MSG, FMT, E, G)
+#define ITEST_ASSERT_NEQ_FMTm(MSG, E, G, FMT)                                \
+    ITEST__REL_FMT(NEQ, !=, MSG, FMT, E, G)
+#define ITEST_ASSERT_GT_FMTm(MSG, E, G, FMT)                                 \
+    ITEST__REL_FMT(GT, >, MSG, FMT, E, G)
+#define ITEST_ASSERT_GTE_FMTm(MSG, E, G, FMT)                                \
+    ITEST__REL_FMT(GTE, >=, MSG, FMT, E, G)
+#define ITEST_ASSERT_LT_FMTm(MSG, E, G, FMT)                                 \
+    ITEST__REL_FMT(LT, <, MSG, FMT, E, G)
+#define ITEST_ASSERT_LTE_FMTm(MSG, E, G, FMT)                                \
+    ITEST__REL_FMT(LTE, <=, MSG, FMT, E, G)
 
 /* Fail if EXP is not equal to GOT, printing enum IDs. */
 #define ITEST_ASSERT_ENUM_EQm(MSG, EXP, GOT, ENUM_STR)                       \
     itest_assert_eq_enum(MSG, __FILE__, __LINE__, ENUM_STR, (int)(EXP),      \
                          (int)(GOT))
 
-/* Fail if GOT not in range of EXP +|- TOL. */
+/* Fail if GOT not in range of EXP +|- TOL.  NaN is only in range of
+ * NaN. */
 #define ITEST_ASSERT_IN_RANGEm(MSG, EXP, GOT, TOL)                           \
     itest_assert_in_range(MSG, __FILE__, __LINE__, EXP, GOT, TOL)
 
@@ -296,17 +967,107 @@ ITEST_NORETURN itest_skip(const char *msg, const char *file,
 #define ITEST_ASSERT_MEM_EQm(MSG, EXP, GOT, SIZE)                            \
     itest_assert_equal_mem(MSG, __FILE__, __LINE__, EXP, GOT, SIZE)
 
+/* Fail if the SIZE bytes at GOT differ from the contents of the golden
+ * file at PATH, printing the first offset where they differ.  The file
+ * is mapped into memory, not read.  With --update-golden, rewrite the
+ * file instead (atomically, by renaming a new file over it).  */
+#define ITEST_ASSERT_MATCHES_GOLDENm(MSG, PATH, GOT, SIZE)                   \
+    itest_assert_golden(MSG, __FILE__, __LINE__, PATH, GOT, SIZE)
+
+/* Like ITEST_ASSERT_MATCHES_GOLDENm, for the contents of the file at
+ * GOT_PATH.  */
+#define ITEST_ASSERT_FILE_MATCHES_GOLDENm(MSG, PATH, GOT_PATH)               \
+    itest_assert_golden_file(MSG, __FILE__, __LINE__, PATH, GOT_PATH)
+
 /* Fail if EXP is not equal to GOT, according to a comparison
  * callback in TYPE_INFO. If they are not equal, optionally use a
  * print callback in TYPE_INFO to print them. */
 #define ITEST_ASSERT_EQUAL_Tm(MSG, EXP, GOT, TYPE_INFO, UDATA)               \
     itest_assert_equal_t(MSG, __FILE__, __LINE__, EXP, GOT, TYPE_INFO, UDATA)
 
+/* Fail if any of the COUNT elements of the array GOT differs from the
+ * corresponding element of the array EXP, comparing them as signed
+ * integers, unsigned integers, or floating-point numbers (with ==) of
+ * GOT's element type.  The whole array is checked, as one assertion; on
+ * failure, the number of differing elements, and the first few of them,
+ * are reported. */
+#define ITEST_ASSERT_INT_ARRAY_EQm(MSG, EXP, GOT, COUNT)                     \
+    itest_assert_array_eq(MSG, __FILE__, __LINE__, ITEST_ELEM_INT, EXP, GOT, \
+                          COUNT, sizeof *(GOT))
+#define ITEST_ASSERT_UINT_ARRAY_EQm(MSG, EXP, GOT, COUNT)                    \
+    itest_assert_array_eq(MSG, __FILE__, __LINE__, ITEST_ELEM_UINT, EXP,     \
+                          GOT, COUNT, sizeof *(GOT))
+#define ITEST_ASSERT_FP_ARRAY_EQm(MSG, EXP, GOT, COUNT)                      \
+    itest_assert_array_eq(MSG, __FILE__, __LINE__, ITEST_ELEM_FP, EXP, GOT,  \
+                          COUNT, sizeof *(GOT))
+
+/* As ITEST_ASSERT_EQUAL_Tm, for each of the COUNT elements of the
+ * arrays EXP and GOT, as one assertion. */
+#define ITEST_ASSERT_ARRAY_EQUAL_Tm(MSG, EXP, GOT, COUNT, TYPE_INFO, UDATA)  \
+    itest_assert_array_equal_t(MSG, __FILE__, __LINE__, EXP, GOT, COUNT,     \
+                               sizeof *(GOT), TYPE_INFO, UDATA)
+
+/* Fail if GOT is more than ULPS units in the last place away from EXP,
+ * or if its error relative to EXP (or GOT, if that is larger) is more
+ * than TOL.  GOT must be a float or a double, and both are compared as
+ * that type.  NaN is only equal to NaN, and +0 to -0.  The ARRAY forms
+ * check each of the COUNT elements of the arrays EXP and GOT, as one
+ * assertion; on failure, they report the number of elements out of
+ * tolerance, the largest error and where it is, and the first few
+ * elements out of tolerance. */
+#define ITEST_ASSERT_WITHIN_ULPSm(MSG, EXP, GOT, ULPS)                       \
+    itest_assert_within_ulps(MSG, __FILE__, __LINE__, EXP, GOT, ULPS,        \
+                             sizeof(GOT))
+#define ITEST_ASSERT_WITHIN_RELm(MSG, EXP, GOT, TOL)                         \
+    itest_assert_within_rel(MSG, __FILE__, __LINE__, EXP, GOT, TOL,          \
+                            sizeof(GOT))
+#define ITEST_ASSERT_ARRAY_WITHIN_ULPSm(MSG, EXP, GOT, COUNT, ULPS)          \
+    itest_assert_array_within_ulps(MSG, __FILE__, __LINE__, EXP, GOT, COUNT, \
+                                   sizeof *(GOT), ULPS)
+#define ITEST_ASSERT_ARRAY_WITHIN_RELm(MSG, EXP, GOT, COUNT, TOL)            \
+    itest_assert_array_within_rel(MSG, __FILE__, __LINE__, EXP, GOT, COUNT,  \
+                                  sizeof *(GOT), TOL)
+
+/* Fail if any of the COUNT elements of the array GOT is not equal to
+ * the single value EXP, as for the array assertions above. */
+#define ITEST_ASSERT_INT_ALL_EQm(MSG, EXP, GOT, COUNT)                       \
+    itest_assert_all_eq(MSG, __FILE__, __LINE__, ITEST_ELEM_INT,             \
+                        (unsigned long long)(EXP), GOT, COUNT, sizeof *(GOT))
+#define ITEST_ASSERT_UINT_ALL_EQm(MSG, EXP, GOT, COUNT)                      \
+    itest_assert_all_eq(MSG, __FILE__, __LINE__, ITEST_ELEM_UINT,            \
+                        (unsigned long long)(EXP), GOT, COUNT, sizeof *(GOT))
+#define ITEST_ASSERT_FP_ALL_EQm(MSG, EXP, GOT, COUNT)                        \
+    itest_assert_all_eq_fp(MSG, __FILE__, __LINE__, (double)(EXP), GOT,      \
+                           COUNT, sizeof *(GOT))
+
 /* Fail. */
 #define ITEST_FAILm(MSG) itest_fail(MSG, __FILE__, __LINE__)
+#define ITEST_FAILf(...) itest_failf(__FILE__, __LINE__, __VA_ARGS__)
 
 /* Skip the current test. */
 #define ITEST_SKIPm(MSG) itest_skip(MSG, __FILE__, __LINE__)
+#define ITEST_SKIPf(...) itest_skipf(__FILE__, __LINE__, __VA_ARGS__)
+
+/* Assertions, FAIL, and SKIP may also be used in helper threads started
+ * by a test.  A failure in a helper thread is recorded (only the first
+ * one, if several threads fail) and then the helper thread exits.  The
+ * test itself fails with the recorded message when it next calls
+ * ITEST_CHECK_THREADS, or when it returns.  Call this after joining the
+ * helper threads.  Helper threads may call it too; if a sibling thread
+ * has already failed, the caller exits.
+ *
+ * All helper threads must be joined before the test function returns.
+ */
+#define ITEST_CHECK_THREADS() itest_check_threads()
+
+/* A helper thread started by a parallel-safe test running on the thread
+ * pool must say which test it belongs to before it makes assertions:
+ * pass it the value of ITEST_CURRENT_TEST() from the test, and call
+ * ITEST_ADOPT_TEST() with that value first thing in the thread.
+ * Otherwise a failure in it aborts the run.  Helper threads of other
+ * tests may do the same, but needn't.  */
+#define ITEST_CURRENT_TEST()   itest_current_test()
+#define ITEST_ADOPT_TEST(TEST) itest_adopt_test(TEST)
 
 /* Run every suite / test function run within a block in pseudo-random
  * order, seeded by SEED. (The top 3 bits of the seed are ignored.)
@@ -26,23 +26,59 @@ else:
             return s
 
 
+# Substitutions applied, in order, to each line of a test's output by
+# filter_log.
+LOG_FILTERS = [
+    (re.compile(r"(\.c(?:c|pp)?:)\d+"), r"\1nn"),
+    (re.compile(r", seed \d+$"), ", seed nnnnn"),
+    (re.compile(r"\(\d+ ticks, \d+\.\d+ sec\)"), "(nn ticks, n.nnn sec)"),
+    (
+        re.compile(
+            r"\(\d+ ticks, \d+\.\d+ sec; setup \d+, body \d+, teardown \d+\)"
+        ),
+        "(nn ticks, n.nnn sec; setup nn, body nn, teardown nn)"
+    ),
+    (
+        re.compile(r"init_second_pass: a \d+, c \d+, state \d+"),
+        "init_second_pass: <<variable>>"
+    ),
+    (
+        re.compile(r"Suite setup \d+ ticks, teardown \d+ ticks"),
+        "Suite setup nn ticks, teardown nn ticks"
+    ),
+    (re.compile(r"\d+ ops, \d+ ops/sec"), "nn ops, nn ops/sec"),
+    (
+        re.compile(r"\d+ ops/sec, speedup \d+\.\d+, efficiency \d+\.\d+"),
+        "nn ops/sec, speedup n.nn, efficiency n.nn"
+    ),
+    (re.compile(r"\d+\.\d+ ns/op"), "n.nn ns/op"),
+    (re.compile(r"\d+ ns\b"), "nn ns"),
+    # -P's event counts, and -R's resource usage
+    (
+        re.compile(r"[\[{][a-z-]+ \d+(?:, [A-Za-z-]+ [\d.]+)*[\]}]"),
+        lambda m: re.sub(r"\d+(?:\.\d+)?", "nn", m.group(0))
+    ),
+    (
+        re.compile(
+            r"profile: \d+ samples(?: \(\d+ dropped\))?, \d+\.\d+% overhead"
+        ),
+        "profile: nn samples, n.nn% overhead"
+    ),
+]
+
+
+def filter_line(line: str) -> str:
+    for pattern, repl in LOG_FILTERS:
+        line = pattern.sub(repl, line)
+    return line
+
+
 def filter_log(log: str) -> str:
     """Return an edited version of LOG, redacting elements that are expected
        to vary from run to run of a test.
     """
-    rsub = re.sub
     return "\n".join(
-        rsub(
-            r"init_second_pass: a \d+, c \d+, state \d+",
-            "init_second_pass: <<variable>>",
-            rsub(
-                r"\(\d+ ticks, \d+\.\d+ sec\)", "(nn ticks, n.nnn sec)",
-                rsub(
-                    r", seed \d+$", ", seed nnnnn",
-                    rsub(r"(\.c(?:c|pp)?:)\d+", r"\1nn", line.rstrip())
-                )
-            )
-        ) for line in log.splitlines()
+        filter_line(line.rstrip()) for line in log.splitlines()
     ) + "\n"
 
 
@@ -71,10 +107,14 @@ def test_example(exp_file: str) -> None:
         expected = fp.read()
     example = removesuffix(exp_file, ".exp")
     args = []
-    for opt in ['-T', '-v']:
-        if example.endswith(opt):
-            example = example[:-len(opt)]
-            args.append(opt)
+    stripped = True
+    while stripped:
+        stripped = False
+        for opt in ['-T', '-v', '-A']:
+            if example.endswith(opt):
+                example = example[:-len(opt)]
+                args.insert(0, opt)
+                stripped = True
     actual = run_suite(example, args)
 
     assert actual == expected
@@ -0,0 +1,122 @@
+#! /usr/bin/python3
+
+"""Tests of the measurement switches whose output varies too much from
+   one machine to another to compare with an .exp file: which event
+   counters exist, which resource usage figures change, and where the
+   profile and timeline go.
+"""
+
+import json
+import os
+import re
+import subprocess
+import sys
+from typing import List, Tuple
+
+import pytest
+
+from test_example import EXAMPLE_DIR, filter_log
+
+MEASURE = os.path.join(EXAMPLE_DIR, "measure")
+TESTS = ["spin", "read_zeros", "count_up", "fail_once"]
+
+
+def run_measure(args: List[str]) -> Tuple[str, int]:
+    result = subprocess.run(
+        [MEASURE] + args,
+        stdin=subprocess.DEVNULL,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.STDOUT,
+        encoding="utf-8",
+    )
+    if result.returncode < 0:
+        result.check_returncode()
+    return result.stdout, result.returncode
+
+
+def result_lines(log: str) -> List[str]:
+    return [line for line in log.splitlines()
+            if re.match(r"(PASS|FAIL|SKIP) ", line)]
+
+
+def test_help_lists_switches() -> None:
+    log, status = run_measure(["-h"])
+    assert status == 0
+    for opt in ["-P", "-R", "-A", "--profile DIR", "--trace FILE"]:
+        assert opt in log
+
+
+@pytest.mark.parametrize("opt", ["--profile", "--trace"])
+def test_missing_argument(opt: str) -> None:
+    log, status = run_measure([opt])
+    assert status == 1
+    assert "Unknown argument '{}'".format(opt) in log
+    assert "Usage:" in log
+
+
+def test_perf_counters() -> None:
+    log, _ = run_measure(["-v", "-P"])
+    lines = result_lines(filter_log(log))
+    assert len(lines) == len(TESTS)
+    if "Event counters unavailable" in log:
+        assert not any("[" in line for line in lines)
+    else:
+        for line in lines:
+            assert re.search(
+                r"\(nn ticks, n\.nnn sec\) "
+                r"\[[a-z-]+ nn(, [a-z-]+ nn)*(, IPC nn)?\]$",
+                line,
+            ), line
+
+
+def test_resource_usage() -> None:
+    log, _ = run_measure(["-v", "-R"])
+    lines = result_lines(log)
+    assert len(lines) == len(TESTS)
+    for line in result_lines(filter_log(log)):
+        assert re.search(r"\(nn ticks, n\.nnn sec\)( \{.*\})?$", line), line
+    assert "\nHighest resource usage:\n" in log
+    if sys.platform.startswith("linux"):
+        # only the test's own reads, not the runner's
+        assert lines[1].endswith("{read-calls 2, read-bytes 30}")
+        assert "  read-calls: read_zeros 2\n" in log
+        assert "  read-bytes: read_zeros 30\n" in log
+
+
+@pytest.mark.skipif(not sys.platform.startswith("linux"),
+                    reason="the profiler needs setitimer and backtrace")
+def test_profile(tmp_path) -> None:
+    log, _ = run_measure(["-v", "--profile", str(tmp_path), "-t", "spin"])
+    path = os.path.join(str(tmp_path), "measurements.spin.folded")
+    assert "    profile: nn samples, n.nn% overhead, in {}\n".format(
+        path) in filter_log(log)
+    with open(path, "rt", encoding="utf-8") as fp:
+        stacks = fp.read().splitlines()
+    assert stacks
+    total = 0
+    for stack in stacks:
+        m = re.fullmatch(r"\S+ (\d+)", stack)
+        assert m, stack
+        total += int(m.group(1))
+    assert "profile: {} samples".format(total) in log
+
+
+def test_trace(tmp_path) -> None:
+    path = os.path.join(str(tmp_path), "trace.json")
+    run_measure(["--trace", path])
+    with open(path, "rt", encoding="utf-8") as fp:
+        trace = json.load(fp)
+    spans = [ev for ev in trace["traceEvents"] if ev["ph"] == "X"]
+    for ev in spans:
+        assert ev["ts"] >= 0 and ev["dur"] >= 0
+    tests = [ev for ev in spans if ev["cat"] == "test"]
+    assert [ev["name"] for ev in tests] == TESTS
+    assert [ev["args"]["result"] for ev in tests] == [
+        "pass", "pass", "pass", "fail"]
+    assert [ev["name"] for ev in spans if ev["cat"] == "suite"] == [
+        "measurements"]
+    run = [ev for ev in spans if ev["cat"] == "run"]
+    assert len(run) == 1
+    for ev in tests:
+        assert run[0]["ts"] <= ev["ts"]
+        assert ev["ts"] + ev["dur"] <= run[0]["ts"] + run[0]["dur"]